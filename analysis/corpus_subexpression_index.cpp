@@ -0,0 +1,181 @@
+#include "corpus_subexpression_index.h"
+#include "../ast/canonical_text.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+bool CountsFirst(const RepeatedSubexpression& lhs, const RepeatedSubexpression& rhs) {
+    if (lhs.count != rhs.count) {
+        return lhs.count > rhs.count;
+    }
+    if (lhs.height != rhs.height) {
+        return lhs.height > rhs.height;
+    }
+    if (lhs.node_count != rhs.node_count) {
+        return lhs.node_count > rhs.node_count;
+    }
+    return lhs.canonical < rhs.canonical;
+}
+}
+
+CorpusSubexpressionIndex::CorpusSubexpressionIndex() : CorpusSubexpressionIndex(Options()) {}
+
+CorpusSubexpressionIndex::CorpusSubexpressionIndex(const Options& options) : options_(options) {
+    if (options_.width == 0 || options_.depth == 0 || options_.capacity == 0) {
+        throw std::invalid_argument("CorpusSubexpressionIndex needs a non-zero width, depth and capacity");
+    }
+    size_t width = 1;
+    while (width < options_.width) {
+        width <<= 1;
+    }
+    options_.width = width;
+    mask_ = width - 1;
+    counters_.assign(width * options_.depth, 0);
+    heap_.reserve(options_.capacity);
+    positions_.reserve(options_.capacity);
+}
+
+void CorpusSubexpressionIndex::add(const AST& ast) {
+    ++expressions_;
+    AST::PostOrderRange nodes = ast.postOrder();
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        const AST::NodePtr& node = it.handle();
+        if (node->height < options_.min_height) {
+            continue;
+        }
+        ++subtrees_;
+        uint64_t count = increment(node->hash);
+        auto found = positions_.find(node->hash);
+        if (found != positions_.end()) {
+            heap_[found->second].count = count;
+            siftDown(found->second);
+        } else {
+            admit(node, count);
+        }
+    }
+}
+
+uint64_t& CorpusSubexpressionIndex::counter(size_t row, const StructuralHash& hash) {
+    return counters_[row * options_.width + ((hash.low + row * (hash.high | 1)) & mask_)];
+}
+
+uint64_t CorpusSubexpressionIndex::counter(size_t row, const StructuralHash& hash) const {
+    return counters_[row * options_.width + ((hash.low + row * (hash.high | 1)) & mask_)];
+}
+
+uint64_t CorpusSubexpressionIndex::increment(const StructuralHash& hash) {
+    uint64_t least = std::numeric_limits<uint64_t>::max();
+    for (size_t row = 0; row < options_.depth; ++row) {
+        least = std::min(least, counter(row, hash));
+    }
+    ++least;
+    for (size_t row = 0; row < options_.depth; ++row) {
+        uint64_t& slot = counter(row, hash);
+        slot = std::max(slot, least);
+    }
+    return least;
+}
+
+void CorpusSubexpressionIndex::admit(const AST::NodePtr& node, uint64_t count) {
+    if (heap_.size() == options_.capacity) {
+        if (count <= heap_.front().count) {
+            return;
+        }
+        positions_.erase(heap_.front().hash);
+        heap_.front() = {node->hash, count, node->height, node->node_count, label(*node)};
+        positions_[node->hash] = 0;
+        siftDown(0);
+        return;
+    }
+
+    size_t position = heap_.size();
+    heap_.push_back({node->hash, count, node->height, node->node_count, label(*node)});
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (heap_[parent].count <= heap_[position].count) {
+            break;
+        }
+        std::swap(heap_[parent], heap_[position]);
+        positions_[heap_[position].hash] = position;
+        position = parent;
+    }
+    positions_[heap_[position].hash] = position;
+}
+
+std::string CorpusSubexpressionIndex::label(const AST::Node& node) const {
+    std::string text = CanonicalText::print(node, options_.max_label_length);
+    if (node.canonical_length > options_.max_label_length) {
+        text += "...";
+    }
+    return text;
+}
+
+void CorpusSubexpressionIndex::siftDown(size_t position) {
+    while (true) {
+        size_t smallest = position;
+        for (size_t child = 2 * position + 1; child <= 2 * position + 2 && child < heap_.size(); ++child) {
+            if (heap_[child].count < heap_[smallest].count) {
+                smallest = child;
+            }
+        }
+        if (smallest == position) {
+            break;
+        }
+        std::swap(heap_[smallest], heap_[position]);
+        positions_[heap_[position].hash] = position;
+        position = smallest;
+    }
+    positions_[heap_[position].hash] = position;
+}
+
+size_t CorpusSubexpressionIndex::expressionCount() const {
+    return expressions_;
+}
+
+size_t CorpusSubexpressionIndex::subtreeCount() const {
+    return subtrees_;
+}
+
+size_t CorpusSubexpressionIndex::estimate(const AST::Node& node) const {
+    uint64_t least = std::numeric_limits<uint64_t>::max();
+    for (size_t row = 0; row < options_.depth; ++row) {
+        least = std::min(least, counter(row, node.hash));
+    }
+    return static_cast<size_t>(least);
+}
+
+size_t CorpusSubexpressionIndex::errorBound() const {
+    return static_cast<size_t>(std::ceil(std::exp(1.0) * static_cast<double>(subtrees_) /
+                                         static_cast<double>(options_.width)));
+}
+
+double CorpusSubexpressionIndex::confidence() const {
+    return 1.0 - std::exp(-static_cast<double>(options_.depth));
+}
+
+size_t CorpusSubexpressionIndex::memoryBytes() const {
+    size_t bytes = counters_.capacity() * sizeof(uint64_t) + heap_.capacity() * sizeof(Candidate);
+    for (const Candidate& candidate : heap_) {
+        bytes += candidate.label.capacity();
+    }
+    bytes += positions_.bucket_count() * sizeof(void*);
+    bytes += positions_.size() * (sizeof(std::pair<const StructuralHash, size_t>) + 2 * sizeof(void*));
+    return bytes;
+}
+
+std::vector<RepeatedSubexpression> CorpusSubexpressionIndex::top(size_t k) const {
+    std::vector<RepeatedSubexpression> result;
+    for (const Candidate& candidate : heap_) {
+        if (candidate.count >= 2) {
+            result.push_back({candidate.label, static_cast<size_t>(candidate.count), candidate.height,
+                              candidate.node_count, {}});
+        }
+    }
+    k = std::min(k, result.size());
+    std::partial_sort(result.begin(), result.begin() + k, result.end(), CountsFirst);
+    result.resize(k);
+    return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../ast/ast.h"
+#include "../ast/structural_hash.h"
+#include "subexpression_finder.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CorpusSubexpressionIndex {
+  public:
+    struct Options {
+        size_t width = size_t{1} << 16;
+        size_t depth = 4;
+        size_t capacity = 256;
+        size_t min_height = 2;
+        size_t max_label_length = 256;
+    };
+
+    CorpusSubexpressionIndex();
+    explicit CorpusSubexpressionIndex(const Options& options);
+
+    void add(const AST& ast);
+
+    size_t expressionCount() const;
+    size_t subtreeCount() const;
+    size_t estimate(const AST::Node& node) const;
+    size_t errorBound() const;
+    double confidence() const;
+    size_t memoryBytes() const;
+
+    std::vector<RepeatedSubexpression> top(size_t k) const;
+
+  private:
+    struct Candidate {
+        StructuralHash hash;
+        uint64_t count = 0;
+        size_t height = 0;
+        size_t node_count = 0;
+        std::string label;
+    };
+
+    Options options_;
+    size_t mask_ = 0;
+    std::vector<uint64_t> counters_;
+    std::vector<Candidate> heap_;
+    std::unordered_map<StructuralHash, size_t, StructuralHashHasher> positions_;
+    size_t expressions_ = 0;
+    size_t subtrees_ = 0;
+
+    uint64_t& counter(size_t row, const StructuralHash& hash);
+    uint64_t counter(size_t row, const StructuralHash& hash) const;
+    uint64_t increment(const StructuralHash& hash);
+    void admit(const AST::NodePtr& node, uint64_t count);
+    void siftDown(size_t position);
+    std::string label(const AST::Node& node) const;
+};
@@ -1,57 +1,21 @@
 #include "msp_checker.h"
 #include "../util/subtree_utils.h"
 #include <unordered_map>
-#include <unordered_set>
 #include <utility>
 
 namespace {
-bool EvaluateClosed(const AST::NodePtr& node,
-                    std::unordered_set<std::string> bound,
-                    std::unordered_map<const AST::Node*, bool>& memo) {
-    if (!node) {
-        return true;
-    }
-
-    auto memo_it = memo.find(node.get());
-    if (memo_it != memo.end()) {
-        return memo_it->second;
-    }
-
-    bool closed = false;
-    const Token& token = node->token;
+struct Pending {
+    AST::NodePtr node;
+    SymbolId unbind;
+    bool exit;
+    bool parameter;
+};
 
-    switch (token.type) {
-        case TokenType::Number:
-            closed = true;
-            break;
-        case TokenType::ID:
-            closed = bound.find(token.value) != bound.end();
-            break;
-        case TokenType::UnaryOperator:
-            closed = EvaluateClosed(node->left, std::move(bound), memo);
-            break;
-        case TokenType::BinaryOperator: {
-            auto left_bound = bound;
-            bool left_closed = EvaluateClosed(node->left, std::move(left_bound), memo);
-            bool right_closed = EvaluateClosed(node->right, std::move(bound), memo);
-            closed = left_closed && right_closed;
-            break;
-        }
-        case TokenType::Lambda: {
-            if (node->left && node->left->token.type == TokenType::ID) {
-                bound.insert(node->left->token.value);
-                memo[node->left.get()] = true;
-            }
-            closed = EvaluateClosed(node->right, std::move(bound), memo);
-            break;
-        }
-        default:
-            closed = false;
-            break;
+SymbolId LambdaParameter(const AST::Node& node) {
+    if (node.left && node.left->token.type == TokenType::ID) {
+        return node.left->token.symbol;
     }
-
-    memo[node.get()] = closed;
-    return closed;
+    return kNoSymbol;
 }
 }
 
@@ -62,28 +26,98 @@ std::vector<AST::NodePtr> MSPChecker::FindMaximallyClosed(const AST& ast) const
         return result;
     }
 
-    std::unordered_map<const AST::Node*, bool> closed_memo;
-    EvaluateClosed(root, {}, closed_memo);
-
-    std::vector<AST::NodePtr> traversal;
-    util::CollectNodesPreOrder(root, traversal);
-
-    for (const auto& node : traversal) {
-        auto closed_it = closed_memo.find(node.get());
-        if (closed_it == closed_memo.end() || !closed_it->second) {
+    BoundSymbols bound;
+    std::vector<Pending> pending = {{root, kNoSymbol, false, false}};
+    while (!pending.empty()) {
+        Pending entry = std::move(pending.back());
+        pending.pop_back();
+        if (entry.exit) {
+            bound.unbind(entry.unbind);
             continue;
         }
-        auto parent = node->parent.lock();
-        if (!parent) {
+        const AST::NodePtr& node = entry.node;
+        bool parameter = entry.parameter && node->token.type == TokenType::ID;
+        if (parameter || util::IsClosedSubtree(node, bound)) {
             result.push_back(node);
             continue;
         }
-        auto parent_it = closed_memo.find(parent.get());
-        if (parent_it == closed_memo.end() || !parent_it->second) {
-            result.push_back(node);
+        if (node->token.type == TokenType::Lambda) {
+            SymbolId symbol = LambdaParameter(*node);
+            pending.push_back({nullptr, symbol, true, false});
+            if (node->right) {
+                pending.push_back({node->right, kNoSymbol, false, false});
+            }
+            if (node->left) {
+                pending.push_back({node->left, kNoSymbol, false, true});
+            }
+            bound.bind(symbol);
+            continue;
+        }
+        for (const AST::NodePtr& child : {node->right, node->left}) {
+            if (child) {
+                pending.push_back({child, kNoSymbol, false, false});
+            }
         }
     }
 
     return result;
 }
 
+std::vector<FlatAST::Index> MSPChecker::FindMaximallyClosed(const FlatAST& ast) const {
+    std::vector<FlatAST::Index> result;
+    if (ast.empty()) {
+        return result;
+    }
+
+    std::vector<bool> closed(ast.size(), false);
+    std::vector<std::pair<FlatAST::Index, SymbolId>> scopes;
+    BoundSymbols bound;
+    for (FlatAST::Index i = ast.root() + 1; i-- > 0;) {
+        while (!scopes.empty() && scopes.back().first > i) {
+            bound.unbind(scopes.back().second);
+            scopes.pop_back();
+        }
+        FlatAST::Index parent = ast.parent(i);
+        bool parameter = parent != FlatAST::kNone && ast.opcode(parent) == FlatAST::Opcode::Lambda &&
+                         ast.left(parent) == i;
+        if (ast.opcode(i) == FlatAST::Opcode::Identifier) {
+            closed[i] = parameter || bound.isBound(ast.payload(i));
+        } else if (ast.opcode(i) == FlatAST::Opcode::Lambda) {
+            FlatAST::Index left = ast.left(i);
+            SymbolId symbol = left != FlatAST::kNone && ast.opcode(left) == FlatAST::Opcode::Identifier
+                                  ? ast.payload(left)
+                                  : kNoSymbol;
+            bound.bind(symbol);
+            scopes.push_back({ast.subtreeBegin(i), symbol});
+        }
+    }
+
+    for (FlatAST::Index i = 0; i < ast.size(); ++i) {
+        FlatAST::Index left = ast.left(i);
+        FlatAST::Index right = ast.right(i);
+        switch (ast.opcode(i)) {
+            case FlatAST::Opcode::Number:
+                closed[i] = true;
+                break;
+            case FlatAST::Opcode::Identifier:
+                break;
+            case FlatAST::Opcode::Function:
+                closed[i] = left == FlatAST::kNone || closed[left];
+                break;
+            case FlatAST::Opcode::Lambda:
+                closed[i] = right == FlatAST::kNone || closed[right];
+                break;
+            default:
+                closed[i] = (left == FlatAST::kNone || closed[left]) && (right == FlatAST::kNone || closed[right]);
+                break;
+        }
+    }
+
+    for (FlatAST::Index i = 0; i < ast.size(); ++i) {
+        FlatAST::Index parent = ast.parent(i);
+        if (closed[i] && (parent == FlatAST::kNone || !closed[parent])) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
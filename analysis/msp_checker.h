@@ -1,10 +1,12 @@
 #pragma once
 
 #include "../ast/ast.h"
+#include "../ast/flat_ast.h"
 #include <vector>
 
 class MSPChecker {
   public:
     std::vector<AST::NodePtr> FindMaximallyClosed(const AST& ast) const;
+    std::vector<FlatAST::Index> FindMaximallyClosed(const FlatAST& ast) const;
 };
 
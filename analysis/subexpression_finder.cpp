@@ -1,106 +1,751 @@
 #include "subexpression_finder.h"
 #include "../util/subtree_utils.h"
 #include <algorithm>
-#include <functional>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <string_view>
+#include <utility>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace {
-struct AggregateInfo {
-    size_t height = 0;
-    size_t node_count = 0;
-    std::vector<AST::NodePtr> nodes;
+constexpr uint32_t kNoClass = std::numeric_limits<uint32_t>::max();
+constexpr size_t kMaxIndexedArity = 32;
+constexpr size_t kMaxPairwiseClasses = 32;
+constexpr size_t kMinTaskNodes = 4096;
+constexpr size_t kTasksPerThread = 8;
+constexpr size_t kInlineTaskFraction = 16;
+
+template <typename Occurrence>
+struct StructuralGroup {
+    TokenType type;
+    std::string_view value;
+    uint32_t left;
+    uint32_t right;
+    uint32_t next;
+    size_t height;
+    size_t node_count;
+    StructuralHash hash;
+    std::vector<Occurrence> occurrences;
+};
+
+template <typename Occurrence>
+class StructuralGroups {
+  public:
+    uint32_t classify(const TokenView& token, uint32_t left, uint32_t right, const StructuralHash& hash,
+                      size_t height, size_t node_count, Occurrence occurrence) {
+        uint32_t id = intern(token.type, token.value, left, right, hash, height, node_count);
+        groups_[id].occurrences.push_back(std::move(occurrence));
+        return id;
+    }
+
+    uint32_t merge(StructuralGroup<Occurrence>& group, uint32_t left, uint32_t right) {
+        uint32_t id = intern(group.type, group.value, left, right, group.hash, group.height, group.node_count);
+        std::vector<Occurrence>& occurrences = groups_[id].occurrences;
+        if (occurrences.empty()) {
+            occurrences = std::move(group.occurrences);
+        } else {
+            occurrences.insert(occurrences.end(), std::make_move_iterator(group.occurrences.begin()),
+                               std::make_move_iterator(group.occurrences.end()));
+        }
+        return id;
+    }
+
+    std::vector<StructuralGroup<Occurrence>>& groups() {
+        return groups_;
+    }
+
+  private:
+    std::unordered_map<StructuralHash, uint32_t, StructuralHashHasher> buckets_;
+    std::vector<StructuralGroup<Occurrence>> groups_;
+
+    uint32_t intern(TokenType type, std::string_view value, uint32_t left, uint32_t right, const StructuralHash& hash,
+                    size_t height, size_t node_count) {
+        bool commutative = type == TokenType::BinaryOperator && (value == "+" || value == "*");
+        if (commutative && right < left) {
+            std::swap(left, right);
+        }
+        auto [bucket, inserted] = buckets_.emplace(hash, kNoClass);
+        for (uint32_t id = bucket->second; id != kNoClass; id = groups_[id].next) {
+            const StructuralGroup<Occurrence>& group = groups_[id];
+            if (group.type == type && group.left == left && group.right == right && group.value == value) {
+                return id;
+            }
+        }
+        uint32_t id = static_cast<uint32_t>(groups_.size());
+        groups_.push_back({type, value, left, right, bucket->second, height, node_count, hash, {}});
+        bucket->second = id;
+        return id;
+    }
+};
+
+template <typename Repeated>
+bool ComesFirst(const Repeated& lhs, const Repeated& rhs) {
+    if (lhs.height != rhs.height) {
+        return lhs.height > rhs.height;
+    }
+    if (lhs.count != rhs.count) {
+        return lhs.count > rhs.count;
+    }
+    if (lhs.node_count != rhs.node_count) {
+        return lhs.node_count > rhs.node_count;
+    }
+    return lhs.canonical < rhs.canonical;
+}
+
+size_t Savings(size_t count, size_t node_count) {
+    return (count - 1) * node_count;
+}
+
+template <typename Repeated>
+bool RanksFirst(SubexpressionFinder::Ranking ranking, const Repeated& lhs, const Repeated& rhs) {
+    if (ranking == SubexpressionFinder::Ranking::Savings) {
+        size_t left = Savings(lhs.count, lhs.node_count);
+        size_t right = Savings(rhs.count, rhs.node_count);
+        if (left != right) {
+            return left > right;
+        }
+    }
+    return ComesFirst(lhs, rhs);
+}
+
+struct RankedRepeat {
+    size_t count;
+    size_t height;
+    size_t node_count;
+    uint32_t id;
 };
 
-bool HasCoveredAncestor(const AST::NodePtr& node,
-                        const std::unordered_set<const AST::Node*>& covered) {
-    auto current = node->parent.lock();
-    while (current) {
-        if (covered.find(current.get()) != covered.end()) {
+template <typename Label>
+class LazyLabels {
+  public:
+    explicit LazyLabels(Label label) : label_(std::move(label)) {}
+
+    const std::string& operator()(uint32_t id) {
+        auto [it, inserted] = labels_.try_emplace(id);
+        if (inserted) {
+            it->second = label_(id);
+        }
+        return it->second;
+    }
+
+    std::string take(uint32_t id) {
+        auto it = labels_.find(id);
+        return it == labels_.end() ? label_(id) : std::move(it->second);
+    }
+
+  private:
+    Label label_;
+    std::unordered_map<uint32_t, std::string> labels_;
+};
+
+template <typename Less>
+class TopRepeats {
+  public:
+    TopRepeats(const SubexpressionFinder::Query& query, Less less) : query_(query), less_(std::move(less)) {}
+
+    void offer(size_t count, size_t height, size_t node_count, uint32_t id) {
+        if (count < std::max<size_t>(query_.min_count, 2) || height < query_.min_height ||
+            (query_.exclude_leaves && height == 1)) {
+            return;
+        }
+        RankedRepeat entry{count, height, node_count, id};
+        auto ranks_first = [this](const RankedRepeat& lhs, const RankedRepeat& rhs) {
+            return ranksFirst(lhs, rhs);
+        };
+        if (query_.top_k == 0) {
+            entries_.push_back(entry);
+        } else if (entries_.size() < query_.top_k) {
+            entries_.push_back(entry);
+            std::push_heap(entries_.begin(), entries_.end(), ranks_first);
+        } else if (ranksFirst(entry, entries_.front())) {
+            std::pop_heap(entries_.begin(), entries_.end(), ranks_first);
+            entries_.back() = entry;
+            std::push_heap(entries_.begin(), entries_.end(), ranks_first);
+        }
+    }
+
+    const std::vector<RankedRepeat>& entries() const {
+        return entries_;
+    }
+
+    size_t occurrenceLimit(size_t count) const {
+        return query_.max_occurrences == 0 ? count : std::min(count, query_.max_occurrences);
+    }
+
+    template <typename Result>
+    void sort(std::vector<Result>& result) const {
+        std::sort(result.begin(), result.end(), [this](const Result& lhs, const Result& rhs) {
+            return RanksFirst(query_.ranking, lhs, rhs);
+        });
+    }
+
+  private:
+    const SubexpressionFinder::Query& query_;
+    Less less_;
+    std::vector<RankedRepeat> entries_;
+
+    bool ranksFirst(const RankedRepeat& lhs, const RankedRepeat& rhs) const {
+        if (query_.ranking == SubexpressionFinder::Ranking::Savings) {
+            size_t left = Savings(lhs.count, lhs.node_count);
+            size_t right = Savings(rhs.count, rhs.node_count);
+            if (left != right) {
+                return left > right;
+            }
+        }
+        if (lhs.height != rhs.height) {
+            return lhs.height > rhs.height;
+        }
+        if (lhs.count != rhs.count) {
+            return lhs.count > rhs.count;
+        }
+        if (lhs.node_count != rhs.node_count) {
+            return lhs.node_count > rhs.node_count;
+        }
+        if (less_(lhs.id, rhs.id)) {
             return true;
         }
-        current = current->parent.lock();
+        return !less_(rhs.id, lhs.id) && lhs.id < rhs.id;
     }
-    return false;
+};
+
+template <typename Occurrence>
+const Occurrence& Resolve(const Occurrence& occurrence) {
+    return occurrence;
 }
+
+const AST::NodePtr& Resolve(const AST::NodePtr* slot) {
+    return *slot;
 }
 
-std::vector<RepeatedSubexpression> SubexpressionFinder::find(const AST& ast) const {
+template <typename Result, typename Occurrence, typename Canonical>
+std::vector<Result> SelectMaximal(const std::vector<StructuralGroup<Occurrence>>& groups,
+                                  const std::vector<uint32_t>& node_classes, const std::vector<uint32_t>& parents,
+                                  Canonical canonical, const SubexpressionFinder::Query& query) {
+    size_t max_height = 0;
+    for (uint32_t id : node_classes) {
+        max_height = std::max(max_height, groups[id].height);
+    }
+    std::vector<uint32_t> level_begin(max_height + 2, 0);
+    for (uint32_t id : node_classes) {
+        ++level_begin[max_height - groups[id].height + 1];
+    }
+    for (size_t level = 1; level < level_begin.size(); ++level) {
+        level_begin[level] += level_begin[level - 1];
+    }
+    std::vector<uint32_t> by_height(node_classes.size());
+    std::vector<uint32_t> cursor(level_begin.begin(), level_begin.end() - 1);
+    for (uint32_t node = 0; node < node_classes.size(); ++node) {
+        by_height[cursor[max_height - groups[node_classes[node]].height]++] = node;
+    }
+
+    std::vector<bool> accepted(groups.size(), false);
+    std::vector<bool> exposed(groups.size(), false);
+    std::vector<bool> inside(node_classes.size(), false);
+    for (size_t level = 0; level + 1 < level_begin.size(); ++level) {
+        for (uint32_t i = level_begin[level]; i < level_begin[level + 1]; ++i) {
+            uint32_t node = by_height[i];
+            uint32_t parent = parents[node];
+            inside[node] = parent != kNoClass && (inside[parent] || accepted[node_classes[parent]]);
+            if (!inside[node]) {
+                exposed[node_classes[node]] = true;
+            }
+        }
+        for (uint32_t i = level_begin[level]; i < level_begin[level + 1]; ++i) {
+            uint32_t id = node_classes[by_height[i]];
+            accepted[id] = exposed[id] && groups[id].occurrences.size() >= 2;
+        }
+    }
+
+    LazyLabels labels([&](uint32_t id) { return canonical(Resolve(groups[id].occurrences.front())); });
+    TopRepeats top(query, [&labels](uint32_t lhs, uint32_t rhs) { return labels(lhs) < labels(rhs); });
+    for (uint32_t id = 0; id < groups.size(); ++id) {
+        if (accepted[id]) {
+            top.offer(groups[id].occurrences.size(), groups[id].height, groups[id].node_count, id);
+        }
+    }
+
+    std::vector<Result> result;
+    result.reserve(top.entries().size());
+    for (const RankedRepeat& entry : top.entries()) {
+        const StructuralGroup<Occurrence>& group = groups[entry.id];
+        Result item;
+        item.canonical = labels.take(entry.id);
+        item.count = group.occurrences.size();
+        item.height = group.height;
+        item.node_count = group.node_count;
+        item.occurrences.reserve(top.occurrenceLimit(item.count));
+        for (size_t i = 0; i < top.occurrenceLimit(item.count); ++i) {
+            item.occurrences.push_back(Resolve(group.occurrences[i]));
+        }
+        result.push_back(std::move(item));
+    }
+    top.sort(result);
+    return result;
+}
+
+struct DagInfo {
+    size_t occurrences = 0;
+    size_t uncovered = 0;
+};
+
+std::vector<AST::NodePtr> PostOrderUnique(const AST::NodePtr& root,
+                                          std::unordered_map<const AST::Node*, DagInfo>& info) {
+    std::vector<AST::NodePtr> order;
+    std::vector<std::pair<AST::NodePtr, bool>> stack = {{root, false}};
+    while (!stack.empty()) {
+        auto [node, expanded] = std::move(stack.back());
+        stack.pop_back();
+        if (expanded) {
+            order.push_back(std::move(node));
+            continue;
+        }
+        if (!info.emplace(node.get(), DagInfo{}).second) {
+            continue;
+        }
+        stack.push_back({node, true});
+        for (const AST::NodePtr& child : {node->right, node->left}) {
+            if (child && info.find(child.get()) == info.end()) {
+                stack.push_back({child, false});
+            }
+        }
+    }
+    return order;
+}
+
+template <typename Canonical>
+std::vector<RepeatedSubexpression> FindInSharedDag(const AST::NodePtr& root, Canonical canonical,
+                                                   const SubexpressionFinder::Query& query) {
+    std::unordered_map<const AST::Node*, DagInfo> info;
+    std::vector<AST::NodePtr> order = PostOrderUnique(root, info);
+
+    info[root.get()].occurrences = 1;
+    info[root.get()].uncovered = 1;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const DagInfo& parent = info[it->get()];
+        for (const AST::NodePtr& child : {(*it)->left, (*it)->right}) {
+            if (child) {
+                info[child.get()].occurrences += parent.occurrences;
+            }
+        }
+    }
+
+    std::vector<AST::NodePtr> by_height = order;
+    std::stable_sort(by_height.begin(), by_height.end(),
+                     [](const AST::NodePtr& lhs, const AST::NodePtr& rhs) {
+                         return lhs->height > rhs->height;
+                     });
+
+    LazyLabels labels([&](uint32_t id) { return canonical(by_height[id]); });
+    TopRepeats top(query, [&labels](uint32_t lhs, uint32_t rhs) { return labels(lhs) < labels(rhs); });
+    for (uint32_t i = 0; i < by_height.size(); ++i) {
+        const AST::NodePtr& node = by_height[i];
+        const DagInfo& entry = info[node.get()];
+        bool accepted = entry.occurrences >= 2 && entry.uncovered > 0;
+        if (accepted) {
+            top.offer(entry.occurrences, node->height, node->node_count, i);
+        }
+        for (const AST::NodePtr& child : {node->left, node->right}) {
+            if (child && !accepted) {
+                info[child.get()].uncovered += entry.uncovered;
+            }
+        }
+    }
+
     std::vector<RepeatedSubexpression> result;
-    auto root = ast.getRoot();
-    if (!root) {
-        return result;
+    result.reserve(top.entries().size());
+    for (const RankedRepeat& entry : top.entries()) {
+        const AST::NodePtr& node = by_height[entry.id];
+        RepeatedSubexpression item;
+        item.canonical = labels.take(entry.id);
+        item.count = entry.count;
+        item.height = node->height;
+        item.node_count = node->node_count;
+        item.occurrences.push_back(node);
+        result.push_back(std::move(item));
     }
+    top.sort(result);
+    return result;
+}
 
-    std::unordered_map<std::string, AggregateInfo> aggregates;
+using OperandPairIndex = std::unordered_map<uint64_t, std::vector<uint32_t>>;
 
-    std::function<std::pair<size_t, size_t>(const AST::NodePtr&)> dfs =
-        [&](const AST::NodePtr& node) -> std::pair<size_t, size_t> {
-            if (!node) {
-                return {0, 0};
+uint64_t PairKey(uint32_t first, uint32_t second) {
+    return (static_cast<uint64_t>(first) << 32) | second;
+}
+
+ACRepeatedSubexpression DescribeOperandSet(const ACNormalForm& form,
+                                           const std::vector<StructuralGroup<ACNormalForm::Index>>& groups,
+                                           std::string_view op, const std::vector<uint32_t>& operands) {
+    ACRepeatedSubexpression item;
+    item.partial = true;
+    item.node_count = operands.size() - 1;
+    std::vector<std::string> forms;
+    for (uint32_t operand : operands) {
+        ACNormalForm::Index representative = groups[operand].occurrences.front();
+        item.height = std::max(item.height, form.height(representative) + 1);
+        item.node_count += form.nodeCount(representative);
+        forms.push_back(form.canonical(representative));
+    }
+    std::sort(forms.begin(), forms.end());
+    item.canonical = std::string(op) + "(";
+    for (size_t i = 0; i < forms.size(); ++i) {
+        item.canonical += (i == 0 ? "" : ",") + forms[i];
+    }
+    item.canonical += ")";
+    return item;
+}
+
+std::vector<ACRepeatedSubexpression> FindRepeatedOperandSets(
+    const ACNormalForm& form, const std::vector<StructuralGroup<ACNormalForm::Index>>& groups) {
+    std::vector<std::vector<uint32_t>> members(groups.size());
+    std::unordered_map<std::string_view, OperandPairIndex> indexes;
+    for (uint32_t id = 0; id < groups.size(); ++id) {
+        ACNormalForm::Index representative = groups[id].occurrences.front();
+        size_t arity = form.arity(representative);
+        if (!ACNormalForm::isAssociativeCommutative(form.token(representative)) || arity > kMaxIndexedArity) {
+            continue;
+        }
+        std::vector<uint32_t>& operands = members[id];
+        for (size_t i = 0; i < arity; ++i) {
+            operands.push_back(form.classId(form.operand(representative, i)));
+        }
+        std::sort(operands.begin(), operands.end());
+        OperandPairIndex& index = indexes[groups[id].value];
+        for (size_t i = 0; i < arity; ++i) {
+            if (i > 0 && operands[i] == operands[i - 1]) {
+                continue;
+            }
+            for (size_t j = i + 1; j < arity; ++j) {
+                if (j == i + 1 || operands[j] != operands[j - 1]) {
+                    index[PairKey(operands[i], operands[j])].push_back(id);
+                }
             }
-            auto left = dfs(node->left);
-            auto right = dfs(node->right);
-            std::string canonical = util::CanonicalForm(node);
-            size_t height = 1 + std::max(left.first, right.first);
-            size_t count = 1 + left.second + right.second;
+        }
+    }
 
-            auto& info = aggregates[canonical];
-            info.height = height;
-            info.node_count = count;
-            info.nodes.push_back(node);
-            return {height, count};
+    std::vector<ACRepeatedSubexpression> result;
+    std::unordered_set<uint64_t> intersected;
+    for (auto& [op, index] : indexes) {
+        std::set<std::vector<uint32_t>> reported;
+        auto report = [&](std::vector<uint32_t> common, const std::vector<uint32_t>& supersets) {
+            if (common.size() < 2 || !reported.insert(common).second) {
+                return;
+            }
+            ACRepeatedSubexpression item = DescribeOperandSet(form, groups, op, common);
+            for (uint32_t superset : supersets) {
+                const std::vector<uint32_t>& operands = members[superset];
+                if (std::includes(operands.begin(), operands.end(), common.begin(), common.end())) {
+                    const auto& occurrences = groups[superset].occurrences;
+                    item.occurrences.insert(item.occurrences.end(), occurrences.begin(), occurrences.end());
+                }
+            }
+            std::sort(item.occurrences.begin(), item.occurrences.end());
+            item.count = item.occurrences.size();
+            result.push_back(std::move(item));
         };
 
-    dfs(root);
+        for (const auto& [pair, classes] : index) {
+            if (classes.size() > kMaxPairwiseClasses) {
+                std::vector<uint32_t> common = members[classes.front()];
+                std::vector<uint32_t> narrowed;
+                for (size_t i = 1; i < classes.size() && common.size() > 2; ++i) {
+                    narrowed.clear();
+                    std::set_intersection(common.begin(), common.end(), members[classes[i]].begin(),
+                                          members[classes[i]].end(), std::back_inserter(narrowed));
+                    std::swap(common, narrowed);
+                }
+                report(std::move(common), classes);
+                continue;
+            }
+            for (size_t a = 0; a < classes.size(); ++a) {
+                for (size_t b = a + 1; b < classes.size(); ++b) {
+                    if (!intersected.insert(PairKey(classes[a], classes[b])).second) {
+                        continue;
+                    }
+                    std::vector<uint32_t> common;
+                    std::set_intersection(members[classes[a]].begin(), members[classes[a]].end(),
+                                          members[classes[b]].begin(), members[classes[b]].end(),
+                                          std::back_inserter(common));
+                    report(std::move(common), classes);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+struct TreeClassification {
+    StructuralGroups<const AST::NodePtr*> groups;
+    std::vector<uint32_t> node_classes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> operands;
 
-    std::vector<RepeatedSubexpression> candidates;
-    candidates.reserve(aggregates.size());
-    for (auto& [key, value] : aggregates) {
-        if (value.nodes.size() < 2) {
-            continue;
+    void classify(const AST::NodePtr& node, const TokenView& token, const StructuralHash& hash) {
+        uint32_t index = static_cast<uint32_t>(node_classes.size());
+        uint32_t right = kNoClass;
+        uint32_t left = kNoClass;
+        if (node->right) {
+            right = node_classes[operands.back()];
+            parents[operands.back()] = index;
+            operands.pop_back();
         }
-        RepeatedSubexpression info;
-        info.canonical = key;
-        info.count = value.nodes.size();
-        info.height = value.height;
-        info.node_count = value.node_count;
-        info.occurrences = value.nodes;
-        candidates.push_back(std::move(info));
-    }
-
-    std::sort(candidates.begin(), candidates.end(),
-              [](const RepeatedSubexpression& lhs, const RepeatedSubexpression& rhs) {
-                  if (lhs.height != rhs.height) {
-                      return lhs.height > rhs.height;
-                  }
-                  if (lhs.count != rhs.count) {
-                      return lhs.count > rhs.count;
-                  }
-                  if (lhs.node_count != rhs.node_count) {
-                      return lhs.node_count > rhs.node_count;
-                  }
-                  return lhs.canonical < rhs.canonical;
-              });
-
-    std::unordered_set<const AST::Node*> covered;
-    for (auto& candidate : candidates) {
-        bool skip = true;
-        for (auto& occurrence : candidate.occurrences) {
-            if (!HasCoveredAncestor(occurrence, covered)) {
-                skip = false;
-                break;
-            }
-        }
-        if (skip) {
+        if (node->left) {
+            left = node_classes[operands.back()];
+            parents[operands.back()] = index;
+            operands.pop_back();
+        }
+        node_classes.push_back(groups.classify(token, left, right, hash, node->height, node->node_count, &node));
+        parents.push_back(kNoClass);
+        operands.push_back(index);
+    }
+
+    void classifySubtree(const AST::NodePtr& root) {
+        AST::PostOrderRange nodes(root);
+        for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+            const AST::NodePtr& node = it.handle();
+            classify(node, TokenView{node->token.type, node->token.value, node->token.symbol}, node->hash);
+        }
+    }
+
+    void append(TreeClassification& task, std::vector<uint32_t>& remap) {
+        remap.reserve(task.groups.groups().size());
+        for (StructuralGroup<const AST::NodePtr*>& group : task.groups.groups()) {
+            uint32_t left = group.left == kNoClass ? kNoClass : remap[group.left];
+            uint32_t right = group.right == kNoClass ? kNoClass : remap[group.right];
+            remap.push_back(groups.merge(group, left, right));
+        }
+        uint32_t root = static_cast<uint32_t>(node_classes.size() + task.node_classes.size() - 1);
+        node_classes.resize(root + 1, kNoClass);
+        parents.resize(root + 1, kNoClass);
+        node_classes[root] = remap[task.node_classes.back()];
+        operands.push_back(root);
+    }
+};
+
+template <typename Canonical>
+std::vector<RepeatedSubexpression> FindInTreeParallel(const AST::NodePtr& root, util::WorkStealingPool& pool,
+                                                      size_t task_nodes, Canonical canonical,
+                                                      const SubexpressionFinder::Query& query) {
+    size_t inline_nodes = task_nodes / kInlineTaskFraction;
+    std::vector<const AST::NodePtr*> roots;
+    std::vector<const AST::NodePtr*> pending = {&root};
+    while (!pending.empty()) {
+        const AST::NodePtr& node = *pending.back();
+        pending.pop_back();
+        if (node->node_count <= task_nodes) {
+            if (node->node_count >= inline_nodes) {
+                roots.push_back(&node);
+            }
             continue;
         }
-        for (auto& occurrence : candidate.occurrences) {
-            covered.insert(occurrence.get());
+        if (node->right) {
+            pending.push_back(&node->right);
+        }
+        if (node->left) {
+            pending.push_back(&node->left);
         }
-        result.push_back(std::move(candidate));
     }
 
-    return result;
+    std::vector<TreeClassification> tasks(roots.size());
+    pool.run(roots.size(), [&](size_t task, size_t) { tasks[task].classifySubtree(*roots[task]); });
+
+    TreeClassification merged;
+    std::vector<std::vector<uint32_t>> remaps(roots.size());
+    std::vector<uint32_t> offsets(roots.size());
+    size_t next_task = 0;
+    std::vector<std::pair<const AST::NodePtr*, bool>> stack = {{&root, false}};
+    while (!stack.empty()) {
+        auto [slot, expanded] = stack.back();
+        stack.pop_back();
+        const AST::NodePtr& node = *slot;
+        if (expanded) {
+            merged.classify(node, TokenView{node->token.type, node->token.value, node->token.symbol}, node->hash);
+        } else if (node->node_count > task_nodes) {
+            stack.push_back({slot, true});
+            if (node->right) {
+                stack.push_back({&node->right, false});
+            }
+            if (node->left) {
+                stack.push_back({&node->left, false});
+            }
+        } else if (node->node_count < inline_nodes) {
+            merged.classifySubtree(node);
+        } else {
+            offsets[next_task] = static_cast<uint32_t>(merged.node_classes.size());
+            merged.append(tasks[next_task], remaps[next_task]);
+            ++next_task;
+        }
+    }
+
+    pool.run(roots.size(), [&](size_t task, size_t) {
+        const TreeClassification& local = tasks[task];
+        const std::vector<uint32_t>& remap = remaps[task];
+        uint32_t offset = offsets[task];
+        for (size_t i = 0; i < local.node_classes.size(); ++i) {
+            merged.node_classes[offset + i] = remap[local.node_classes[i]];
+            if (local.parents[i] != kNoClass) {
+                merged.parents[offset + i] = local.parents[i] + offset;
+            }
+        }
+    });
+    return SelectMaximal<RepeatedSubexpression>(merged.groups.groups(), merged.node_classes, merged.parents,
+                                                canonical, query);
+}
+
+template <typename Canonical>
+std::vector<RepeatedSubexpression> FindInTree(const AST& ast, const SubexpressionFinder::Options& options,
+                                              util::WorkStealingPool* pool, Canonical canonical,
+                                              const SubexpressionFinder::Query& query) {
+    auto root = ast.getRoot();
+    if (!root) {
+        return {};
+    }
+    bool structural = options.equivalence == SubexpressionFinder::Equivalence::Structural;
+    if (structural && ast.sharing() == AST::Sharing::HashConsed) {
+        return FindInSharedDag(root, canonical, query);
+    }
+    if (structural && pool) {
+        size_t task_nodes = options.task_nodes;
+        if (task_nodes == 0) {
+            task_nodes = std::max(kMinTaskNodes, root->node_count / (pool->threadCount() * kTasksPerThread));
+        }
+        if (root->node_count > 2 * task_nodes) {
+            return FindInTreeParallel(root, *pool, task_nodes, canonical, query);
+        }
+    }
+
+    TreeClassification classification;
+    DeBruijnHashes hashes;
+    if (structural) {
+        classification.classifySubtree(root);
+    } else {
+        hashes = DeBruijnHashes(ast);
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            classification.classify(hashes.node(i), hashes.token(i), hashes.hash(i));
+        }
+    }
+    return SelectMaximal<RepeatedSubexpression>(classification.groups.groups(), classification.node_classes,
+                                                classification.parents, canonical, query);
+}
+}
+
+SubexpressionFinder::SubexpressionFinder(Equivalence equivalence) : SubexpressionFinder(Options{equivalence}) {}
+
+SubexpressionFinder::SubexpressionFinder(const Options& options) : options_(options) {
+    if (options_.threads != 1) {
+        pool_ = std::make_shared<util::WorkStealingPool>(options_.threads);
+    }
+}
+
+SubexpressionFinder::Equivalence SubexpressionFinder::equivalence() const {
+    return options_.equivalence;
+}
+
+size_t SubexpressionFinder::threadCount() const {
+    return pool_ ? pool_->threadCount() : 1;
+}
+
+std::vector<RepeatedSubexpression> SubexpressionFinder::find(const AST& ast) const {
+    return find(ast, Query());
+}
+
+std::vector<RepeatedSubexpression> SubexpressionFinder::find(const AST& ast, const CanonicalText& text) const {
+    return find(ast, text, Query());
+}
+
+std::vector<RepeatedSubexpression> SubexpressionFinder::find(const AST& ast, const Query& query) const {
+    return FindInTree(
+        ast, options_, pool_.get(), [](const AST::NodePtr& node) { return util::CanonicalForm(node); }, query);
 }
 
+std::vector<RepeatedSubexpression> SubexpressionFinder::find(const AST& ast, const CanonicalText& text,
+                                                             const Query& query) const {
+    return FindInTree(
+        ast, options_, pool_.get(),
+        [&text](const AST::NodePtr& node) {
+            return text.contains(*node) ? std::string(text.of(*node)) : util::CanonicalForm(node);
+        },
+        query);
+}
+
+std::vector<FlatRepeatedSubexpression> SubexpressionFinder::find(const FlatAST& ast) const {
+    return find(ast, Query());
+}
+
+std::vector<FlatRepeatedSubexpression> SubexpressionFinder::find(const FlatAST& ast, const Query& query) const {
+    if (ast.empty()) {
+        return {};
+    }
+
+    std::vector<uint32_t> heights(ast.size());
+    std::vector<uint32_t> counts(ast.size());
+    std::vector<StructuralHash> hashes(ast.size());
+    std::vector<uint32_t> classes(ast.size());
+    StructuralGroups<FlatAST::Index> groups;
+    for (FlatAST::Index i = 0; i < ast.size(); ++i) {
+        FlatAST::Index left = ast.left(i);
+        FlatAST::Index right = ast.right(i);
+        uint32_t height = 0;
+        uint32_t count = 1;
+        for (FlatAST::Index child : {left, right}) {
+            if (child != FlatAST::kNone) {
+                height = std::max(height, heights[child]);
+                count += counts[child];
+            }
+        }
+        heights[i] = height + 1;
+        counts[i] = count;
+
+        TokenView token = ast.token(i);
+        hashes[i] = StructuralHash::combine(token.type, token.value,
+                                            left != FlatAST::kNone ? hashes[left] : StructuralHash{},
+                                            right != FlatAST::kNone ? hashes[right] : StructuralHash{});
+        classes[i] = groups.classify(token, left != FlatAST::kNone ? classes[left] : kNoClass,
+                                     right != FlatAST::kNone ? classes[right] : kNoClass, hashes[i], heights[i],
+                                     counts[i], i);
+    }
+
+    return SelectMaximal<FlatRepeatedSubexpression>(
+        groups.groups(), classes, ast.parents(),
+        [&ast](FlatAST::Index node) { return util::CanonicalForm(ast, node); }, query);
+}
+
+std::vector<ACRepeatedSubexpression> SubexpressionFinder::find(const ACNormalForm& form) const {
+    if (form.empty()) {
+        return {};
+    }
+
+    std::vector<StructuralGroup<ACNormalForm::Index>> groups(form.classCount());
+    for (ACNormalForm::Index i = 0; i < form.size(); ++i) {
+        StructuralGroup<ACNormalForm::Index>& group = groups[form.classId(i)];
+        if (group.occurrences.empty()) {
+            group = {form.token(i).type, form.token(i).value, kNoClass, kNoClass, kNoClass,
+                     form.height(i), form.nodeCount(i), form.hash(i), {}};
+        }
+        group.occurrences.push_back(i);
+    }
+    std::vector<ACRepeatedSubexpression> partial = FindRepeatedOperandSets(form, groups);
+
+    std::vector<uint32_t> node_classes(form.size());
+    std::vector<uint32_t> parents(form.size());
+    for (ACNormalForm::Index i = 0; i < form.size(); ++i) {
+        node_classes[i] = form.classId(i);
+        parents[i] = form.parent(i);
+    }
+    std::vector<ACRepeatedSubexpression> result = SelectMaximal<ACRepeatedSubexpression>(
+        groups, node_classes, parents, [&form](ACNormalForm::Index node) { return form.canonical(node); }, Query());
+    std::unordered_set<std::string> whole;
+    for (const ACRepeatedSubexpression& item : result) {
+        whole.insert(item.canonical);
+    }
+    for (ACRepeatedSubexpression& item : partial) {
+        if (whole.find(item.canonical) == whole.end()) {
+            result.push_back(std::move(item));
+        }
+    }
+    std::sort(result.begin(), result.end(), ComesFirst<ACRepeatedSubexpression>);
+    return result;
+}
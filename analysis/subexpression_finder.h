@@ -1,6 +1,12 @@
 #pragma once
 
+#include "../ast/ac_normal_form.h"
 #include "../ast/ast.h"
+#include "../ast/canonical_text.h"
+#include "../ast/de_bruijn_hashes.h"
+#include "../ast/flat_ast.h"
+#include "../util/work_stealing_pool.h"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -12,8 +18,66 @@ struct RepeatedSubexpression {
     std::vector<AST::NodePtr> occurrences;
 };
 
+struct FlatRepeatedSubexpression {
+    std::string canonical;
+    size_t count = 0;
+    size_t height = 0;
+    size_t node_count = 0;
+    std::vector<FlatAST::Index> occurrences;
+};
+
+struct ACRepeatedSubexpression {
+    std::string canonical;
+    size_t count = 0;
+    size_t height = 0;
+    size_t node_count = 0;
+    bool partial = false;
+    std::vector<ACNormalForm::Index> occurrences;
+};
+
 class SubexpressionFinder {
   public:
+    enum class Equivalence {
+        Structural,
+        Alpha,
+    };
+
+    enum class Ranking {
+        Height,
+        Savings,
+    };
+
+    struct Options {
+        Equivalence equivalence = Equivalence::Structural;
+        size_t threads = 1;
+        size_t task_nodes = 0;
+    };
+
+    struct Query {
+        size_t min_count = 2;
+        size_t min_height = 1;
+        bool exclude_leaves = false;
+        size_t top_k = 0;
+        size_t max_occurrences = 0;
+        Ranking ranking = Ranking::Height;
+    };
+
+    explicit SubexpressionFinder(Equivalence equivalence = Equivalence::Structural);
+    explicit SubexpressionFinder(const Options& options);
+
+    Equivalence equivalence() const;
+    size_t threadCount() const;
+
     std::vector<RepeatedSubexpression> find(const AST& ast) const;
+    std::vector<RepeatedSubexpression> find(const AST& ast, const CanonicalText& text) const;
+    std::vector<RepeatedSubexpression> find(const AST& ast, const Query& query) const;
+    std::vector<RepeatedSubexpression> find(const AST& ast, const CanonicalText& text, const Query& query) const;
+    std::vector<FlatRepeatedSubexpression> find(const FlatAST& ast) const;
+    std::vector<FlatRepeatedSubexpression> find(const FlatAST& ast, const Query& query) const;
+    std::vector<ACRepeatedSubexpression> find(const ACNormalForm& form) const;
+
+  private:
+    Options options_;
+    std::shared_ptr<util::WorkStealingPool> pool_;
 };
 
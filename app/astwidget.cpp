@@ -1,12 +1,19 @@
 #include "astwidget.h"
-#include "../util/subtree_utils.h"
 #include <QPainter>
 #include <QPen>
 #include <QtGlobal>
 #include <algorithm>
+#include <string>
 
 namespace {
-QString FormatNodeLabel(const AST::NodePtr& node) {
+std::string Canonical(const CanonicalText& text, const AST::NodePtr& node) {
+    if (!node) {
+        return "";
+    }
+    return text.contains(*node) ? std::string(text.of(*node)) : CanonicalText::print(*node);
+}
+
+QString FormatNodeLabel(const AST::NodePtr& node, const CanonicalText& text) {
     if (!node) {
         return {};
     }
@@ -14,14 +21,14 @@ QString FormatNodeLabel(const AST::NodePtr& node) {
     switch (node->token.type) {
         case TokenType::UnaryOperator: {
             if (node->left) {
-                std::string operand = util::CanonicalForm(node->left);
+                std::string operand = Canonical(text, node->left);
                 return QString::fromStdString(node->token.value + "(" + operand + ")");
             }
             return QString::fromStdString(node->token.value);
         }
         case TokenType::Lambda: {
-            std::string parameter = node->left ? util::CanonicalForm(node->left) : "";
-            std::string body = node->right ? util::CanonicalForm(node->right) : "";
+            std::string parameter = Canonical(text, node->left);
+            std::string body = Canonical(text, node->right);
             return QString::fromStdString("lambda " + parameter + ". " + body);
         }
         default:
@@ -36,8 +43,12 @@ ASTWidget::ASTWidget(QWidget* parent)
 }
 
 void ASTWidget::setTree(const AST& ast) {
+    setTree(ast, CanonicalText(ast.getRoot()));
+}
+
+void ASTWidget::setTree(const AST& ast, const CanonicalText& text) {
     root_ = ast.getRoot();
-    BuildLayout();
+    BuildLayout(text);
     update();
 }
 
@@ -71,11 +82,11 @@ void ASTWidget::paintEvent(QPaintEvent* event) {
         QRectF ellipse(node.position.x() - 20, node.position.y() - 20, 40, 40);
         painter.setBrush(Qt::lightGray);
         painter.drawEllipse(ellipse);
-        painter.drawText(ellipse, Qt::AlignCenter, FormatNodeLabel(node.node));
+        painter.drawText(ellipse, Qt::AlignCenter, node.label);
     }
 }
 
-void ASTWidget::BuildLayout() {
+void ASTWidget::BuildLayout(const CanonicalText& text) {
     positioned_nodes_.clear();
     edges_.clear();
     column_ = 1.0;
@@ -94,7 +105,7 @@ void ASTWidget::BuildLayout() {
     for (const auto& node : nodes) {
         auto it = position_map.find(node.get());
         if (it != position_map.end()) {
-            positioned_nodes_.push_back({node, it->second});
+            positioned_nodes_.push_back({node, it->second, FormatNodeLabel(node, text)});
         }
     }
 
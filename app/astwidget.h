@@ -1,7 +1,9 @@
 #pragma once
 
 #include "../ast/ast.h"
+#include "../ast/canonical_text.h"
 #include <QPointF>
+#include <QString>
 #include <QWidget>
 #include <unordered_map>
 #include <vector>
@@ -12,6 +14,7 @@ class ASTWidget : public QWidget {
     explicit ASTWidget(QWidget* parent = nullptr);
 
     void setTree(const AST& ast);
+    void setTree(const AST& ast, const CanonicalText& text);
     void clear();
 
   protected:
@@ -23,6 +26,7 @@ class ASTWidget : public QWidget {
     struct PositionedNode {
         AST::NodePtr node;
         QPointF position;
+        QString label;
     };
 
     std::vector<PositionedNode> positioned_nodes_;
@@ -31,7 +35,7 @@ class ASTWidget : public QWidget {
     double vertical_spacing_ = 80.0;
     double column_ = 0.0;
 
-    void BuildLayout();
+    void BuildLayout(const CanonicalText& text);
     void AssignPositions(const AST::NodePtr& node, int depth,
                          std::unordered_map<const AST::Node*, QPointF>& map);
     void CollectVisibleNodes(const AST::NodePtr& node,
@@ -1,5 +1,6 @@
 #include "../analysis/msp_checker.h"
 #include "../analysis/subexpression_finder.h"
+#include "../parser/incremental_parser.h"
 #include "../parser/parser.h"
 #include "../util/subtree_utils.h"
 #include "astwidget.h"
@@ -14,6 +15,10 @@
 #include <memory>
 #include <string>
 
+namespace {
+constexpr size_t kRepeatedListSize = 20;
+}
+
 class MainWindow : public QWidget {
     Q_OBJECT
 
@@ -61,26 +66,37 @@ class MainWindow : public QWidget {
             ast_widget_->clear();
             repeated_list_->clear();
             msp_list_->clear();
+            has_ast_ = false;
             return;
         }
 
         try {
-            Parser parser(expression.toStdString());
-            AST ast = parser.buildAST();
-            ast_widget_->setTree(ast);
-
+            std::string source = expression.toStdString();
+            if (has_ast_) {
+                has_ast_ = false;
+                TextEdit edit = IncrementalParser::difference(source_, source);
+                ReparseResult result = IncrementalParser::reparse(std::move(ast_), source_, edit);
+                ast_ = std::move(result.ast);
+            } else {
+                Parser parser(source);
+                ast_ = parser.buildAST();
+            }
+            source_ = std::move(source);
+            has_ast_ = true;
+            const AST& ast = ast_;
+            CanonicalText canonical(ast.getRoot());
+            ast_widget_->setTree(ast, canonical);
+
+            SubexpressionFinder::Query query;
+            query.exclude_leaves = true;
+            query.top_k = kRepeatedListSize;
+            query.max_occurrences = 1;
+            query.ranking = SubexpressionFinder::Ranking::Savings;
             SubexpressionFinder finder;
-            auto repeated = finder.find(ast);
+            auto repeated = finder.find(ast, canonical, query);
 
             repeated_list_->clear();
             for (const auto& item : repeated) {
-            if (item.occurrences.empty()) {
-                continue;
-            }
-            TokenType token_type = item.occurrences.front()->token.type;
-            if (token_type == TokenType::ID || token_type == TokenType::Number) {
-                continue;
-            }
                 QString text =
                     QString::fromStdString(item.canonical + " -> count: " + std::to_string(item.count));
                 repeated_list_->addItem(text);
@@ -90,7 +106,8 @@ class MainWindow : public QWidget {
             auto closed = checker.FindMaximallyClosed(ast);
             msp_list_->clear();
             for (const auto& node : closed) {
-                QString text = QString::fromStdString(util::CanonicalForm(node));
+                QString text = QString::fromStdString(
+                    canonical.contains(*node) ? std::string(canonical.of(*node)) : util::CanonicalForm(node));
                 msp_list_->addItem(text);
             }
 
@@ -115,6 +132,9 @@ class MainWindow : public QWidget {
     ASTWidget* ast_widget_;
     QListWidget* repeated_list_;
     QListWidget* msp_list_;
+    std::string source_;
+    AST ast_;
+    bool has_ast_ = false;
 };
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,195 @@
+#include "ac_normal_form.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr uint32_t kNoClass = std::numeric_limits<uint32_t>::max();
+
+struct Pending {
+    ACNormalForm::Index node = ACNormalForm::kNone;
+    AST::NodePtr chain;
+    std::vector<ACNormalForm::Index> operands;
+};
+
+std::string Join(const Token& token, std::vector<std::string> operands) {
+    if (operands.empty()) {
+        return token.value;
+    }
+    if (ACNormalForm::isAssociativeCommutative(token)) {
+        std::sort(operands.begin(), operands.end());
+    }
+    std::string out = token.type == TokenType::Lambda ? "lambda" : token.value;
+    out += "(";
+    const char* separator = token.type == TokenType::Lambda ? "." : ",";
+    for (size_t i = 0; i < operands.size(); ++i) {
+        out += i == 0 ? "" : separator;
+        out += operands[i];
+    }
+    return out + ")";
+}
+}
+
+ACNormalForm::ACNormalForm(const AST& ast) {
+    std::vector<Pending> pending;
+    auto resolve = [this](Pending& entry) {
+        if (entry.node == kNone) {
+            entry.node = append(std::move(entry.chain), std::move(entry.operands));
+        }
+        return entry.node;
+    };
+
+    AST::PostOrderRange nodes = ast.postOrder();
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        const AST::NodePtr& node = it.handle();
+        auto first = pending.end() - ((node->left ? 1 : 0) + (node->right ? 1 : 0));
+        Pending entry;
+        if (isAssociativeCommutative(node->token)) {
+            entry.chain = node;
+            for (auto child = first; child != pending.end(); ++child) {
+                if (child->node == kNone && child->chain->token.value == node->token.value) {
+                    std::vector<Index>& absorbed = child->operands;
+                    if (absorbed.size() > entry.operands.size()) {
+                        std::swap(absorbed, entry.operands);
+                    }
+                    entry.operands.insert(entry.operands.end(), absorbed.begin(), absorbed.end());
+                } else {
+                    entry.operands.push_back(resolve(*child));
+                }
+            }
+        } else {
+            std::vector<Index> operands;
+            for (auto child = first; child != pending.end(); ++child) {
+                operands.push_back(resolve(*child));
+            }
+            entry.node = append(node, std::move(operands));
+        }
+        pending.erase(first, pending.end());
+        pending.push_back(std::move(entry));
+    }
+    if (!pending.empty()) {
+        resolve(pending.back());
+    }
+}
+
+ACNormalForm::Index ACNormalForm::append(AST::NodePtr source, std::vector<Index> operands) {
+    const Token& token = source->token;
+    if (isAssociativeCommutative(token)) {
+        std::sort(operands.begin(), operands.end(), [this](Index lhs, Index rhs) {
+            if (hash_[lhs] != hash_[rhs]) {
+                return hash_[lhs] < hash_[rhs];
+            }
+            return class_[lhs] < class_[rhs];
+        });
+    }
+
+    Index index = static_cast<Index>(sources_.size());
+    StructuralHash hash = StructuralHash::combine(token.type, token.value, {}, {});
+    uint32_t height = 0;
+    std::vector<uint32_t> operand_classes;
+    operand_classes.reserve(operands.size());
+    for (Index operand : operands) {
+        hash = StructuralHash::combine(token.type, {}, hash, hash_[operand]);
+        height = std::max(height, height_[operand]);
+        operand_classes.push_back(class_[operand]);
+        parent_[operand] = index;
+        operands_.push_back(operand);
+    }
+    operand_begin_.push_back(static_cast<Index>(operands_.size()));
+
+    auto [bucket, inserted] = buckets_.emplace(hash, kNoClass);
+    uint32_t id = bucket->second;
+    while (id != kNoClass && (classes_[id].type != token.type || classes_[id].value != token.value ||
+                              classes_[id].operands != operand_classes)) {
+        id = classes_[id].next;
+    }
+    if (id == kNoClass) {
+        id = static_cast<uint32_t>(classes_.size());
+        classes_.push_back({token.type, token.value, std::move(operand_classes), bucket->second});
+        bucket->second = id;
+    }
+
+    sources_.push_back(std::move(source));
+    parent_.push_back(kNone);
+    class_.push_back(id);
+    hash_.push_back(hash);
+    height_.push_back(height + 1);
+    return index;
+}
+
+bool ACNormalForm::isAssociativeCommutative(const Token& token) {
+    return token.type == TokenType::BinaryOperator && (token.value == "+" || token.value == "*");
+}
+
+size_t ACNormalForm::size() const {
+    return sources_.size();
+}
+
+bool ACNormalForm::empty() const {
+    return sources_.empty();
+}
+
+ACNormalForm::Index ACNormalForm::root() const {
+    return empty() ? kNone : static_cast<Index>(sources_.size() - 1);
+}
+
+size_t ACNormalForm::classCount() const {
+    return classes_.size();
+}
+
+const Token& ACNormalForm::token(Index node) const {
+    return sources_[node]->token;
+}
+
+const AST::NodePtr& ACNormalForm::source(Index node) const {
+    return sources_[node];
+}
+
+ACNormalForm::Index ACNormalForm::parent(Index node) const {
+    return parent_[node];
+}
+
+size_t ACNormalForm::arity(Index node) const {
+    return operand_begin_[node + 1] - operand_begin_[node];
+}
+
+ACNormalForm::Index ACNormalForm::operand(Index node, size_t position) const {
+    return operands_[operand_begin_[node] + position];
+}
+
+uint32_t ACNormalForm::classId(Index node) const {
+    return class_[node];
+}
+
+const StructuralHash& ACNormalForm::hash(Index node) const {
+    return hash_[node];
+}
+
+size_t ACNormalForm::height(Index node) const {
+    return height_[node];
+}
+
+size_t ACNormalForm::nodeCount(Index node) const {
+    return sources_[node]->node_count;
+}
+
+std::string ACNormalForm::canonical(Index node) const {
+    std::vector<std::string> results;
+    std::vector<std::pair<Index, bool>> stack = {{node, false}};
+    while (!stack.empty()) {
+        auto [current, expanded] = stack.back();
+        stack.pop_back();
+        size_t count = arity(current);
+        if (!expanded) {
+            stack.push_back({current, true});
+            for (size_t i = count; i-- > 0;) {
+                stack.push_back({operand(current, i), false});
+            }
+            continue;
+        }
+        std::vector<std::string> operands(std::make_move_iterator(results.end() - count),
+                                          std::make_move_iterator(results.end()));
+        results.resize(results.size() - count);
+        results.push_back(Join(token(current), std::move(operands)));
+    }
+    return std::move(results.back());
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ast.h"
+#include "structural_hash.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ACNormalForm {
+  public:
+    using Index = uint32_t;
+
+    static constexpr Index kNone = std::numeric_limits<Index>::max();
+
+    ACNormalForm() = default;
+    explicit ACNormalForm(const AST& ast);
+
+    static bool isAssociativeCommutative(const Token& token);
+
+    size_t size() const;
+    bool empty() const;
+    Index root() const;
+    size_t classCount() const;
+
+    const Token& token(Index node) const;
+    const AST::NodePtr& source(Index node) const;
+    Index parent(Index node) const;
+    size_t arity(Index node) const;
+    Index operand(Index node, size_t position) const;
+    uint32_t classId(Index node) const;
+    const StructuralHash& hash(Index node) const;
+    size_t height(Index node) const;
+    size_t nodeCount(Index node) const;
+    std::string canonical(Index node) const;
+
+  private:
+    struct Class {
+        TokenType type;
+        std::string_view value;
+        std::vector<uint32_t> operands;
+        uint32_t next;
+    };
+
+    std::vector<AST::NodePtr> sources_;
+    std::vector<Index> operand_begin_ = {0};
+    std::vector<Index> operands_;
+    std::vector<Index> parent_;
+    std::vector<uint32_t> class_;
+    std::vector<StructuralHash> hash_;
+    std::vector<uint32_t> height_;
+    std::vector<Class> classes_;
+    std::unordered_map<StructuralHash, uint32_t, StructuralHashHasher> buckets_;
+
+    Index append(AST::NodePtr source, std::vector<Index> operands);
+};
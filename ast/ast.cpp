@@ -1,4 +1,6 @@
 #include "ast.h"
+#include "canonical_text.h"
+#include "hash_cons_table.h"
 #include <algorithm>
 #include <utility>
 
@@ -8,10 +10,26 @@ void SetParent(const AST::NodePtr& node, const AST::NodePtr& parent) {
         node->parent = parent;
     }
 }
+
+uint64_t SymbolBit(SymbolId symbol) {
+    return symbol < SymbolTable::kLetterCount ? uint64_t{1} << symbol : AST::Node::kUntrackedSymbols;
+}
+
+template <typename Range>
+std::vector<AST::NodePtr> CollectHandles(const Range& range) {
+    std::vector<AST::NodePtr> out;
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        out.push_back(it.handle());
+    }
+    return out;
+}
 }
 
 AST::Node::Node(Token token_value)
-    : token(std::move(token_value)), left(nullptr), right(nullptr), parent() {}
+    : token(std::move(token_value)), left(nullptr), right(nullptr), parent() {
+    internSymbol();
+    updateAttributes();
+}
 
 AST::Node::Node(Token token_value,
                 std::shared_ptr<Node> left_child,
@@ -19,18 +37,112 @@ AST::Node::Node(Token token_value,
     : token(std::move(token_value)),
       left(std::move(left_child)),
       right(std::move(right_child)),
-      parent() {}
+      parent() {
+    internSymbol();
+    updateAttributes();
+}
+
+AST::Node::~Node() {
+    std::vector<NodePtr> pending;
+    auto detach = [&pending](NodePtr& child) {
+        if (child && child.use_count() == 1) {
+            pending.push_back(std::move(child));
+        }
+        child.reset();
+    };
+    detach(left);
+    detach(right);
+    while (!pending.empty()) {
+        NodePtr node = std::move(pending.back());
+        pending.pop_back();
+        detach(node->left);
+        detach(node->right);
+    }
+}
+
+void AST::Node::internSymbol() {
+    if (token.type == TokenType::ID && token.symbol == kNoSymbol) {
+        token.symbol = SymbolTable::global().intern(token.value);
+    }
+}
 
 bool AST::Node::isLeaf() const {
     return !left && !right;
 }
 
+void AST::Node::updateAttributes() {
+    size_t left_height = left ? left->height : 0;
+    size_t right_height = right ? right->height : 0;
+    height = 1 + std::max(left_height, right_height);
+    node_count = 1 + (left ? left->node_count : 0) + (right ? right->node_count : 0);
+
+    hash = StructuralHash::combine(token.type, token.value, left ? left->hash : StructuralHash{},
+                                   right ? right->hash : StructuralHash{});
+
+    size_t left_length = left ? left->canonical_length : 0;
+    size_t right_length = right ? right->canonical_length : 0;
+    canonical_swap = false;
+    switch (token.type) {
+        case TokenType::UnaryOperator:
+            canonical_length = token.value.size() + 2 + left_length;
+            break;
+        case TokenType::BinaryOperator:
+            canonical_length = token.value.size() + 3 + left_length + right_length;
+            if ((token.value == "+" || token.value == "*") && left) {
+                canonical_swap = !right || CanonicalText::compare(*left, *right) > 0;
+            }
+            break;
+        case TokenType::Lambda:
+            canonical_length = 9 + left_length + right_length;
+            break;
+        default:
+            canonical_length = token.value.size();
+            break;
+    }
+
+    switch (token.type) {
+        case TokenType::Number:
+            free_symbols = 0;
+            break;
+        case TokenType::ID:
+            free_symbols = SymbolBit(token.symbol);
+            break;
+        case TokenType::UnaryOperator:
+        case TokenType::BinaryOperator:
+            free_symbols = (left ? left->free_symbols : 0) | (right ? right->free_symbols : 0);
+            break;
+        case TokenType::Lambda: {
+            free_symbols = right ? right->free_symbols : 0;
+            if (left && left->token.type == TokenType::ID && left->token.symbol < SymbolTable::kLetterCount) {
+                free_symbols &= ~SymbolBit(left->token.symbol);
+            }
+            break;
+        }
+        default:
+            free_symbols = kUntrackedSymbols;
+            break;
+    }
+}
+
 AST::AST(NodePtr root) : root_(std::move(root)) {
     if (root_) {
         root_->parent.reset();
     }
 }
 
+AST::AST(Allocation allocation) : AST(allocation, Sharing::Tree) {}
+
+AST::AST(Allocation allocation, Sharing sharing) {
+    if (allocation == Allocation::Arena) {
+        arena_ = NodeArena::create();
+    }
+    if (sharing == Sharing::HashConsed) {
+        unique_table_ = std::make_shared<HashConsTable>();
+    }
+}
+
+AST::AST(std::shared_ptr<NodeArena> arena) : arena_(std::move(arena)) {}
+
 void AST::setRoot(NodePtr root) {
     root_ = std::move(root);
     if (root_) {
@@ -46,69 +158,108 @@ bool AST::empty() const {
     return root_ == nullptr;
 }
 
-void AST::LCRTraversalRec(const NodePtr& node, std::vector<NodePtr>& out) const {
-    if (!node) {
-        return;
-    }
-    LCRTraversalRec(node->left, out);
-    out.push_back(node);
-    LCRTraversalRec(node->right, out);
+AST::InOrderRange AST::inOrder() const& {
+    return InOrderRange(root_);
 }
 
-void AST::LRCTraversalRec(const NodePtr& node, std::vector<NodePtr>& out) const {
-    if (!node) {
-        return;
-    }
-    LRCTraversalRec(node->left, out);
-    LRCTraversalRec(node->right, out);
-    out.push_back(node);
+AST::PostOrderRange AST::postOrder() const& {
+    return PostOrderRange(root_);
 }
 
-void AST::CRLTraversalRec(const NodePtr& node, std::vector<NodePtr>& out) const {
-    if (!node) {
-        return;
-    }
-    out.push_back(node);
-    CRLTraversalRec(node->left, out);
-    CRLTraversalRec(node->right, out);
+AST::PreOrderRange AST::preOrder() const& {
+    return PreOrderRange(root_);
+}
+
+AST::LevelOrderRange AST::levelOrder() const& {
+    return LevelOrderRange(root_);
 }
 
 std::vector<AST::NodePtr> AST::LCRTraversal() const {
-    std::vector<NodePtr> out;
-    if (!root_) {
-        return out;
-    }
-    LCRTraversalRec(root_, out);
-    return out;
+    return CollectHandles(inOrder());
 }
 
 std::vector<AST::NodePtr> AST::LRCTraversal() const {
-    std::vector<NodePtr> out;
-    if (!root_) {
-        return out;
-    }
-    LRCTraversalRec(root_, out);
-    return out;
+    return CollectHandles(postOrder());
 }
 
 std::vector<AST::NodePtr> AST::CRLTraversal() const {
-    std::vector<NodePtr> out;
-    if (!root_) {
-        return out;
-    }
-    CRLTraversalRec(root_, out);
-    return out;
+    return CollectHandles(preOrder());
 }
 
 size_t AST::height() const {
-    return height(root_);
+    return root_ ? root_->height : 0;
+}
+
+AST::Allocation AST::allocation() const {
+    return arena_ ? Allocation::Arena : Allocation::Heap;
+}
+
+std::shared_ptr<NodeArena> AST::arena() const {
+    return arena_;
+}
+
+AST::Sharing AST::sharing() const {
+    return unique_table_ ? Sharing::HashConsed : Sharing::Tree;
+}
+
+const HashConsTable* AST::hashConsTable() const {
+    return unique_table_.get();
+}
+
+size_t AST::arenaBytes() const {
+    return arena_ ? arena_->bytesAllocated() : 0;
 }
 
-size_t AST::height(const NodePtr& node) const {
-    if (!node) {
-        return 0;
+AST::NodePtr AST::allocateNode(Token token, NodePtr left, NodePtr right) {
+    if (!arena_) {
+        return std::make_shared<Node>(std::move(token), std::move(left), std::move(right));
     }
-    return 1 + std::max(height(node->left), height(node->right));
+    return std::allocate_shared<Node>(ArenaAllocator<Node>(arena_.get()), std::move(token),
+                                      std::move(left), std::move(right));
+}
+
+AST::NodePtr AST::internNode(const TokenView& token, NodePtr left, NodePtr right) {
+    return unique_table_->intern(token, left, right, [&] {
+        NodePtr node = allocateNode(token.toToken(), left, right);
+        for (const NodePtr& child : {node->left, node->right}) {
+            if (child && child->parent.expired()) {
+                child->parent = node;
+            }
+        }
+        return node;
+    });
+}
+
+AST::NodePtr AST::makeNode(Token token, NodePtr left, NodePtr right) {
+    if (unique_table_) {
+        return internNode(TokenView{token.type, token.value, token.symbol}, std::move(left),
+                          std::move(right));
+    }
+    NodePtr node = allocateNode(std::move(token), std::move(left), std::move(right));
+    SetParent(node->left, node);
+    SetParent(node->right, node);
+    return node;
+}
+
+AST::NodePtr AST::makeLeaf(Token token) {
+    if (unique_table_) {
+        return internNode(TokenView{token.type, token.value, token.symbol}, nullptr, nullptr);
+    }
+    return allocateNode(std::move(token), nullptr, nullptr);
+}
+
+AST::NodePtr AST::makeNode(const TokenView& token, NodePtr left, NodePtr right) {
+    if (unique_table_) {
+        return internNode(token, std::move(left), std::move(right));
+    }
+    return makeNode(token.toToken(), std::move(left), std::move(right));
+}
+
+AST::NodePtr AST::makeLeaf(const TokenView& token) {
+    if (unique_table_) {
+        return internNode(token, nullptr, nullptr);
+    }
+    return makeLeaf(token.toToken());
 }
 
 AST::NodePtr AST::createNode(Token token,
@@ -123,3 +274,13 @@ AST::NodePtr AST::createNode(Token token,
 AST::NodePtr AST::createLeaf(Token token) {
     return std::make_shared<Node>(std::move(token));
 }
+
+AST::NodePtr AST::createNode(const TokenView& token,
+                             NodePtr left,
+                             NodePtr right) {
+    return createNode(token.toToken(), std::move(left), std::move(right));
+}
+
+AST::NodePtr AST::createLeaf(const TokenView& token) {
+    return createLeaf(token.toToken());
+}
@@ -1,51 +1,116 @@
 #pragma once
 
 #include "../parser/tokenizer.h"
+#include "node_arena.h"
+#include "structural_hash.h"
+#include "traversal.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+class HashConsTable;
+
 class AST {
   public:
+    enum class Allocation {
+        Heap,
+        Arena,
+    };
+
+    enum class Sharing {
+        Tree,
+        HashConsed,
+    };
+
     struct Node {
         Token token;
         std::shared_ptr<Node> left;
         std::shared_ptr<Node> right;
         std::weak_ptr<Node> parent;
+        size_t offset = 0;
+        size_t length = 0;
+        size_t height = 1;
+        size_t node_count = 1;
+        StructuralHash hash;
+        uint64_t free_symbols = 0;
+        size_t canonical_length = 0;
+        bool canonical_swap = false;
+
+        static constexpr uint64_t kUntrackedSymbols = uint64_t{1} << 63;
 
         explicit Node(Token token_value);
         Node(Token token_value,
              std::shared_ptr<Node> left_child,
              std::shared_ptr<Node> right_child);
+        ~Node();
+
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
 
         bool isLeaf() const;
+        void updateAttributes();
+
+      private:
+        void internSymbol();
     };
 
     using NodePtr = std::shared_ptr<Node>;
+    using InOrderRange = TraversalRange<Node, TraversalOrder::InOrder>;
+    using PostOrderRange = TraversalRange<Node, TraversalOrder::PostOrder>;
+    using PreOrderRange = TraversalRange<Node, TraversalOrder::PreOrder>;
+    using LevelOrderRange = TraversalRange<Node, TraversalOrder::LevelOrder>;
 
   private:
     NodePtr root_;
+    std::shared_ptr<NodeArena> arena_;
+    std::shared_ptr<HashConsTable> unique_table_;
+
+    NodePtr allocateNode(Token token, NodePtr left, NodePtr right);
+    NodePtr internNode(const TokenView& token, NodePtr left, NodePtr right);
 
-    void LCRTraversalRec(const NodePtr& node, std::vector<NodePtr>& result) const;
-    void LRCTraversalRec(const NodePtr& node, std::vector<NodePtr>& result) const;
-    void CRLTraversalRec(const NodePtr& node, std::vector<NodePtr>& result) const;
-    size_t height(const NodePtr& node) const;
 
   public:
     AST() = default;
     explicit AST(NodePtr root);
+    explicit AST(Allocation allocation);
+    AST(Allocation allocation, Sharing sharing);
+    explicit AST(std::shared_ptr<NodeArena> arena);
 
     void setRoot(NodePtr root);
     NodePtr getRoot() const;
     bool empty() const;
 
+    InOrderRange inOrder() const&;
+    PostOrderRange postOrder() const&;
+    PreOrderRange preOrder() const&;
+    LevelOrderRange levelOrder() const&;
+    InOrderRange inOrder() const&& = delete;
+    PostOrderRange postOrder() const&& = delete;
+    PreOrderRange preOrder() const&& = delete;
+    LevelOrderRange levelOrder() const&& = delete;
+
     std::vector<NodePtr> LCRTraversal() const;
     std::vector<NodePtr> LRCTraversal() const;
     std::vector<NodePtr> CRLTraversal() const;
     size_t height() const;
+    Allocation allocation() const;
+    size_t arenaBytes() const;
+    std::shared_ptr<NodeArena> arena() const;
+    Sharing sharing() const;
+    const HashConsTable* hashConsTable() const;
+
+    NodePtr makeNode(Token token, NodePtr left, NodePtr right);
+    NodePtr makeLeaf(Token token);
+    NodePtr makeNode(const TokenView& token, NodePtr left, NodePtr right);
+    NodePtr makeLeaf(const TokenView& token);
 
     static NodePtr createNode(Token token,
                               NodePtr left,
                               NodePtr right);
     static NodePtr createLeaf(Token token);
+    static NodePtr createNode(const TokenView& token,
+                              NodePtr left,
+                              NodePtr right);
+    static NodePtr createLeaf(const TokenView& token);
 };
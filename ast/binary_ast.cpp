@@ -0,0 +1,336 @@
+#include "binary_ast.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+constexpr char kMagic[4] = {'A', 'S', 'T', 'B'};
+constexpr size_t kHeaderSize = 32;
+constexpr uint8_t kOpcodeMask = 0x0f;
+constexpr uint8_t kHasLeft = 0x10;
+constexpr uint8_t kHasRight = 0x20;
+
+[[noreturn]] void Corrupt(const std::string& reason) {
+    throw std::runtime_error("Invalid binary AST: " + reason);
+}
+
+bool HasPayload(FlatAST::Opcode opcode) {
+    return opcode == FlatAST::Opcode::Number || opcode == FlatAST::Opcode::Identifier ||
+           opcode == FlatAST::Opcode::Function;
+}
+
+size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+void WriteVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t ReadVarint(std::string_view data, size_t& offset) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (offset >= data.size()) {
+            Corrupt("truncated varint");
+        }
+        uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    Corrupt("overlong varint");
+}
+
+void WriteFixed(std::string& out, size_t offset, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[offset + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+uint64_t ReadFixed(std::string_view data, size_t offset, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[offset + i])) << (8 * i);
+    }
+    return value;
+}
+}
+
+BinaryAST::Node::Node(const BinaryAST* owner, size_t offset) : owner_(owner), offset_(offset) {
+    std::string_view stream = owner->stream_;
+    if (offset >= stream.size()) {
+        Corrupt("node offset out of range");
+    }
+    uint8_t header = static_cast<uint8_t>(stream[offset]);
+    if ((header & kOpcodeMask) > static_cast<uint8_t>(FlatAST::Opcode::Lambda)) {
+        Corrupt("unknown opcode");
+    }
+    opcode_ = static_cast<FlatAST::Opcode>(header & kOpcodeMask);
+    has_left_ = (header & kHasLeft) != 0;
+    has_right_ = (header & kHasRight) != 0;
+
+    size_t cursor = offset + 1;
+    if (HasPayload(opcode_)) {
+        uint64_t payload = ReadVarint(stream, cursor);
+        size_t pool = opcode_ == FlatAST::Opcode::Identifier ? owner->symbols_.size() : owner->literals_.size();
+        if (payload >= pool) {
+            Corrupt("pool index out of range");
+        }
+        payload_ = static_cast<uint32_t>(payload);
+    }
+    uint64_t right_offset = has_left_ && has_right_ ? ReadVarint(stream, cursor) : 0;
+    children_ = cursor;
+    right_ = cursor + right_offset;
+}
+
+BinaryAST::Node::operator bool() const {
+    return owner_ != nullptr;
+}
+
+FlatAST::Opcode BinaryAST::Node::opcode() const {
+    return opcode_;
+}
+
+TokenView BinaryAST::Node::token() const {
+    switch (opcode_) {
+        case FlatAST::Opcode::Number:
+            return {TokenType::Number, owner_->literals_[payload_]};
+        case FlatAST::Opcode::Function:
+            return {TokenType::UnaryOperator, owner_->literals_[payload_]};
+        case FlatAST::Opcode::Identifier: {
+            SymbolId symbol = owner_->symbols_[payload_];
+            return {TokenType::ID, SymbolTable::global().name(symbol), symbol};
+        }
+        case FlatAST::Opcode::Add:
+            return {TokenType::BinaryOperator, "+"};
+        case FlatAST::Opcode::Subtract:
+            return {TokenType::BinaryOperator, "-"};
+        case FlatAST::Opcode::Multiply:
+            return {TokenType::BinaryOperator, "*"};
+        case FlatAST::Opcode::Divide:
+            return {TokenType::BinaryOperator, "/"};
+        case FlatAST::Opcode::Power:
+            return {TokenType::BinaryOperator, "^"};
+        default:
+            return {TokenType::Lambda, "lambda"};
+    }
+}
+
+BinaryAST::Node BinaryAST::Node::left() const {
+    return has_left_ ? Node(owner_, children_) : Node();
+}
+
+BinaryAST::Node BinaryAST::Node::right() const {
+    return has_right_ ? Node(owner_, right_) : Node();
+}
+
+bool BinaryAST::Node::isLeaf() const {
+    return !has_left_ && !has_right_;
+}
+
+size_t BinaryAST::Node::offset() const {
+    return offset_;
+}
+
+std::string BinaryAST::encode(const FlatAST& ast) {
+    std::unordered_map<std::string_view, uint32_t> literal_ids;
+    std::unordered_map<SymbolId, uint32_t> symbol_ids;
+    std::vector<std::string_view> literals;
+    std::vector<SymbolId> symbols;
+    std::vector<uint32_t> payloads(ast.size(), 0);
+    std::vector<uint64_t> bytes(ast.size(), 0);
+    for (FlatAST::Index i = 0; i < ast.size(); ++i) {
+        FlatAST::Opcode opcode = ast.opcode(i);
+        if (opcode == FlatAST::Opcode::Identifier) {
+            auto [it, inserted] = symbol_ids.emplace(ast.payload(i), static_cast<uint32_t>(symbols.size()));
+            if (inserted) {
+                symbols.push_back(ast.payload(i));
+            }
+            payloads[i] = it->second;
+        } else if (HasPayload(opcode)) {
+            std::string_view value = ast.token(i).value;
+            auto [it, inserted] = literal_ids.emplace(value, static_cast<uint32_t>(literals.size()));
+            if (inserted) {
+                literals.push_back(value);
+            }
+            payloads[i] = it->second;
+        }
+
+        FlatAST::Index left = ast.left(i);
+        FlatAST::Index right = ast.right(i);
+        bytes[i] = 1 + (HasPayload(opcode) ? VarintSize(payloads[i]) : 0);
+        if (left != FlatAST::kNone && right != FlatAST::kNone) {
+            bytes[i] += VarintSize(bytes[left]);
+        }
+        bytes[i] += (left != FlatAST::kNone ? bytes[left] : 0) + (right != FlatAST::kNone ? bytes[right] : 0);
+    }
+
+    std::string out(kHeaderSize, '\0');
+    std::memcpy(out.data(), kMagic, sizeof(kMagic));
+    WriteFixed(out, 4, kVersion, 4);
+    WriteFixed(out, 8, ast.size(), 8);
+    WriteFixed(out, 16, ast.empty() ? 0 : bytes[ast.root()], 8);
+    WriteFixed(out, 24, literals.size(), 4);
+    WriteFixed(out, 28, symbols.size(), 4);
+    out.reserve(kHeaderSize + (ast.empty() ? 0 : bytes[ast.root()]));
+
+    std::vector<FlatAST::Index> pending;
+    if (!ast.empty()) {
+        pending.push_back(ast.root());
+    }
+    while (!pending.empty()) {
+        FlatAST::Index node = pending.back();
+        pending.pop_back();
+        FlatAST::Index left = ast.left(node);
+        FlatAST::Index right = ast.right(node);
+        uint8_t header = static_cast<uint8_t>(ast.opcode(node));
+        header |= left != FlatAST::kNone ? kHasLeft : 0;
+        header |= right != FlatAST::kNone ? kHasRight : 0;
+        out.push_back(static_cast<char>(header));
+        if (HasPayload(ast.opcode(node))) {
+            WriteVarint(out, payloads[node]);
+        }
+        if (left != FlatAST::kNone && right != FlatAST::kNone) {
+            WriteVarint(out, bytes[left]);
+        }
+        if (right != FlatAST::kNone) {
+            pending.push_back(right);
+        }
+        if (left != FlatAST::kNone) {
+            pending.push_back(left);
+        }
+    }
+
+    for (std::string_view literal : literals) {
+        WriteVarint(out, literal.size());
+        out.append(literal);
+    }
+    for (SymbolId symbol : symbols) {
+        std::string_view name = SymbolTable::global().name(symbol);
+        WriteVarint(out, name.size());
+        out.append(name);
+    }
+    return out;
+}
+
+std::string BinaryAST::encode(const AST& ast) {
+    return encode(FlatAST(ast));
+}
+
+void BinaryAST::save(const AST& ast, const std::string& path) {
+    std::string bytes = encode(ast);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+BinaryAST::BinaryAST(const std::string& path) : file_(std::in_place, path) {
+    load(file_->view());
+}
+
+BinaryAST BinaryAST::fromBytes(std::string_view bytes) {
+    BinaryAST ast;
+    ast.owned_.assign(bytes.begin(), bytes.end());
+    ast.load({ast.owned_.data(), ast.owned_.size()});
+    return ast;
+}
+
+void BinaryAST::load(std::string_view data) {
+    if (data.size() < kHeaderSize || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        Corrupt("missing header");
+    }
+    if (ReadFixed(data, 4, 4) != kVersion) {
+        Corrupt("unsupported version " + std::to_string(ReadFixed(data, 4, 4)));
+    }
+    uint64_t stream_size = ReadFixed(data, 16, 8);
+    if (stream_size > data.size() - kHeaderSize) {
+        Corrupt("truncated node stream");
+    }
+    uint64_t node_count = ReadFixed(data, 8, 8);
+    if (node_count > stream_size) {
+        Corrupt("node count exceeds node stream");
+    }
+    data_ = data;
+    node_count_ = node_count;
+    stream_ = data.substr(kHeaderSize, stream_size);
+
+    uint64_t literal_count = ReadFixed(data, 24, 4);
+    uint64_t symbol_count = ReadFixed(data, 28, 4);
+    size_t cursor = kHeaderSize + stream_size;
+    for (uint64_t i = 0; i < literal_count + symbol_count; ++i) {
+        uint64_t length = ReadVarint(data, cursor);
+        if (length > data.size() - cursor) {
+            Corrupt("truncated pool");
+        }
+        std::string_view entry = data.substr(cursor, length);
+        cursor += length;
+        if (i < literal_count) {
+            literals_.push_back(entry);
+        } else {
+            symbols_.push_back(SymbolTable::global().intern(entry));
+        }
+    }
+}
+
+BinaryAST::Node BinaryAST::root() const {
+    return stream_.empty() ? Node() : Node(this, 0);
+}
+
+size_t BinaryAST::nodeCount() const {
+    return node_count_;
+}
+
+size_t BinaryAST::byteSize() const {
+    return data_.size();
+}
+
+AST BinaryAST::toAST(AST::Allocation allocation) const {
+    std::vector<Node> records;
+    records.reserve(node_count_);
+    for (size_t offset = 0; offset < stream_.size(); offset = records.back().children_) {
+        records.push_back(Node(this, offset));
+    }
+
+    AST ast(allocation);
+    std::vector<AST::NodePtr> operands;
+    auto pop = [&operands](bool present) {
+        if (!present) {
+            return AST::NodePtr();
+        }
+        if (operands.empty()) {
+            Corrupt("missing child");
+        }
+        AST::NodePtr operand = std::move(operands.back());
+        operands.pop_back();
+        return operand;
+    };
+    for (auto it = records.rbegin(); it != records.rend(); ++it) {
+        if (it->isLeaf()) {
+            operands.push_back(ast.makeLeaf(it->token()));
+            continue;
+        }
+        AST::NodePtr left = pop(it->has_left_);
+        AST::NodePtr right = pop(it->has_right_);
+        operands.push_back(ast.makeNode(it->token(), std::move(left), std::move(right)));
+    }
+    if (operands.size() > 1) {
+        Corrupt("unexpected trailing nodes");
+    }
+    if (!operands.empty()) {
+        ast.setRoot(std::move(operands.back()));
+    }
+    return ast;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../util/mapped_file.h"
+#include "ast.h"
+#include "flat_ast.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BinaryAST {
+  public:
+    static constexpr uint32_t kVersion = 1;
+
+    class Node {
+      public:
+        Node() = default;
+
+        explicit operator bool() const;
+        FlatAST::Opcode opcode() const;
+        TokenView token() const;
+        Node left() const;
+        Node right() const;
+        bool isLeaf() const;
+        size_t offset() const;
+
+      private:
+        friend class BinaryAST;
+
+        const BinaryAST* owner_ = nullptr;
+        size_t offset_ = 0;
+        size_t children_ = 0;
+        size_t right_ = 0;
+        uint32_t payload_ = 0;
+        FlatAST::Opcode opcode_ = FlatAST::Opcode::Number;
+        bool has_left_ = false;
+        bool has_right_ = false;
+
+        Node(const BinaryAST* owner, size_t offset);
+    };
+
+    static std::string encode(const FlatAST& ast);
+    static std::string encode(const AST& ast);
+    static void save(const AST& ast, const std::string& path);
+
+    explicit BinaryAST(const std::string& path);
+    static BinaryAST fromBytes(std::string_view bytes);
+
+    Node root() const;
+    size_t nodeCount() const;
+    size_t byteSize() const;
+    AST toAST(AST::Allocation allocation = AST::Allocation::Heap) const;
+
+  private:
+    std::optional<util::MappedFile> file_;
+    std::vector<char> owned_;
+    std::string_view data_;
+    std::string_view stream_;
+    size_t node_count_ = 0;
+    std::vector<std::string_view> literals_;
+    std::vector<SymbolId> symbols_;
+
+    BinaryAST() = default;
+    void load(std::string_view data);
+};
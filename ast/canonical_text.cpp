@@ -0,0 +1,169 @@
+#include "canonical_text.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+struct Piece {
+    const AST::Node* node = nullptr;
+    std::string_view text;
+    const AST::Node* closes = nullptr;
+    size_t begin = 0;
+};
+
+std::string_view FirstPiece(const AST::Node& node) {
+    return node.token.type == TokenType::Lambda ? std::string_view("lambda(") : std::string_view(node.token.value);
+}
+
+void PushNode(const AST::NodePtr& node, std::vector<Piece>& stack) {
+    if (node) {
+        stack.push_back({node.get(), {}, nullptr, 0});
+    }
+}
+
+void Expand(const AST::Node& node, std::vector<Piece>& stack) {
+    switch (node.token.type) {
+        case TokenType::UnaryOperator:
+            stack.push_back({nullptr, ")"});
+            PushNode(node.left, stack);
+            stack.push_back({nullptr, "("});
+            stack.push_back({nullptr, node.token.value});
+            break;
+        case TokenType::BinaryOperator: {
+            const AST::NodePtr& first = node.canonical_swap ? node.right : node.left;
+            const AST::NodePtr& second = node.canonical_swap ? node.left : node.right;
+            stack.push_back({nullptr, ")"});
+            PushNode(second, stack);
+            stack.push_back({nullptr, ","});
+            PushNode(first, stack);
+            stack.push_back({nullptr, "("});
+            stack.push_back({nullptr, node.token.value});
+            break;
+        }
+        case TokenType::Lambda:
+            stack.push_back({nullptr, ")"});
+            PushNode(node.right, stack);
+            stack.push_back({nullptr, "."});
+            PushNode(node.left, stack);
+            stack.push_back({nullptr, "lambda("});
+            break;
+        default:
+            stack.push_back({nullptr, node.token.value});
+            break;
+    }
+}
+
+class CanonicalStream {
+  public:
+    explicit CanonicalStream(const AST::Node& node) {
+        Expand(node, stack_);
+    }
+
+    std::string_view next() {
+        while (!stack_.empty()) {
+            Piece piece = stack_.back();
+            stack_.pop_back();
+            if (piece.node) {
+                Expand(*piece.node, stack_);
+            } else if (!piece.text.empty()) {
+                return piece.text;
+            }
+        }
+        return {};
+    }
+
+  private:
+    std::vector<Piece> stack_;
+};
+}
+
+CanonicalText::CanonicalText(const AST::NodePtr& root) {
+    if (!root) {
+        return;
+    }
+    text_.reserve(root->canonical_length);
+    spans_.reserve(root->node_count);
+    std::vector<Piece> stack;
+    PushNode(root, stack);
+    while (!stack.empty()) {
+        Piece piece = stack.back();
+        stack.pop_back();
+        if (piece.closes) {
+            spans_.emplace(piece.closes, std::make_pair(piece.begin, text_.size() - piece.begin));
+        } else if (piece.node) {
+            stack.push_back({nullptr, {}, piece.node, text_.size()});
+            Expand(*piece.node, stack);
+        } else {
+            text_.append(piece.text);
+        }
+    }
+}
+
+std::string_view CanonicalText::text() const {
+    return text_;
+}
+
+std::string_view CanonicalText::of(const AST::Node& node) const {
+    auto it = spans_.find(&node);
+    if (it == spans_.end()) {
+        return {};
+    }
+    return std::string_view(text_).substr(it->second.first, it->second.second);
+}
+
+bool CanonicalText::contains(const AST::Node& node) const {
+    return spans_.find(&node) != spans_.end();
+}
+
+size_t CanonicalText::length(const AST::Node& node) {
+    return node.canonical_length;
+}
+
+int CanonicalText::compare(const AST::Node& lhs, const AST::Node& rhs) {
+    if (&lhs == &rhs || lhs.hash == rhs.hash) {
+        return 0;
+    }
+    std::string_view lhs_first = FirstPiece(lhs);
+    std::string_view rhs_first = FirstPiece(rhs);
+    size_t prefix = std::min(lhs_first.size(), rhs_first.size());
+    if (int order = std::memcmp(lhs_first.data(), rhs_first.data(), prefix); order != 0) {
+        return order < 0 ? -1 : 1;
+    }
+
+    CanonicalStream lhs_stream(lhs);
+    CanonicalStream rhs_stream(rhs);
+    std::string_view lhs_chunk;
+    std::string_view rhs_chunk;
+    while (true) {
+        if (lhs_chunk.empty()) {
+            lhs_chunk = lhs_stream.next();
+        }
+        if (rhs_chunk.empty()) {
+            rhs_chunk = rhs_stream.next();
+        }
+        if (lhs_chunk.empty() || rhs_chunk.empty()) {
+            return lhs_chunk.empty() == rhs_chunk.empty() ? 0 : (lhs_chunk.empty() ? -1 : 1);
+        }
+        size_t common = std::min(lhs_chunk.size(), rhs_chunk.size());
+        if (int order = std::memcmp(lhs_chunk.data(), rhs_chunk.data(), common); order != 0) {
+            return order < 0 ? -1 : 1;
+        }
+        lhs_chunk.remove_prefix(common);
+        rhs_chunk.remove_prefix(common);
+    }
+}
+
+void CanonicalText::append(const AST::Node& node, std::string& out, size_t limit) {
+    size_t end = out.size() + std::min(node.canonical_length, limit);
+    out.reserve(end);
+    CanonicalStream stream(node);
+    for (std::string_view chunk = stream.next(); !chunk.empty() && out.size() < end; chunk = stream.next()) {
+        out.append(chunk.substr(0, end - out.size()));
+    }
+}
+
+std::string CanonicalText::print(const AST::Node& node, size_t limit) {
+    std::string out;
+    append(node, out, limit);
+    return out;
+}
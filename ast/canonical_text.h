@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ast.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+class CanonicalText {
+  public:
+    CanonicalText() = default;
+    explicit CanonicalText(const AST::NodePtr& root);
+
+    std::string_view text() const;
+    std::string_view of(const AST::Node& node) const;
+    bool contains(const AST::Node& node) const;
+
+    static size_t length(const AST::Node& node);
+    static int compare(const AST::Node& lhs, const AST::Node& rhs);
+    static void append(const AST::Node& node, std::string& out, size_t limit = std::string::npos);
+    static std::string print(const AST::Node& node, size_t limit = std::string::npos);
+
+  private:
+    std::string text_;
+    std::unordered_map<const AST::Node*, std::pair<size_t, size_t>> spans_;
+};
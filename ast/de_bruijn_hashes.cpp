@@ -0,0 +1,107 @@
+#include "de_bruijn_hashes.h"
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+constexpr std::string_view kBinderName = "#";
+
+struct Frame {
+    const AST::NodePtr* node;
+    bool expanded;
+    bool binder;
+};
+
+SymbolId BoundSymbol(const AST::Node& node) {
+    if (node.token.type == TokenType::Lambda && node.left && node.left->token.type == TokenType::ID) {
+        return node.left->token.symbol;
+    }
+    return kNoSymbol;
+}
+}
+
+DeBruijnHashes::DeBruijnHashes(const AST& ast) {
+    AST::NodePtr root = ast.getRoot();
+    if (!root) {
+        return;
+    }
+
+    std::unordered_map<SymbolId, std::vector<size_t>> binder_levels;
+    size_t lambda_depth = 0;
+    std::vector<StructuralHash> operands;
+    std::vector<Frame> stack = {{&root, false, false}};
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const AST::NodePtr& node = *frame.node;
+        if (!frame.expanded) {
+            frame.expanded = true;
+            SymbolId bound = BoundSymbol(*node);
+            if (bound != kNoSymbol) {
+                binder_levels[bound].push_back(++lambda_depth);
+            }
+            if (node->right) {
+                stack.push_back({&node->right, false, false});
+            }
+            if (node->left) {
+                stack.push_back({&node->left, false, bound != kNoSymbol});
+            }
+            continue;
+        }
+
+        bool binder = frame.binder;
+        stack.pop_back();
+        std::string_view key = node->token.value;
+        if (binder) {
+            key = kBinderName;
+        } else if (node->token.type == TokenType::ID) {
+            auto levels = binder_levels.find(node->token.symbol);
+            if (levels != binder_levels.end() && !levels->second.empty()) {
+                key = distanceName(lambda_depth - levels->second.back());
+            }
+        }
+
+        StructuralHash right = node->right ? operands.back() : StructuralHash{};
+        if (node->right) {
+            operands.pop_back();
+        }
+        StructuralHash left = node->left ? operands.back() : StructuralHash{};
+        if (node->left) {
+            operands.pop_back();
+        }
+        SymbolId bound = BoundSymbol(*node);
+        if (bound != kNoSymbol) {
+            binder_levels[bound].pop_back();
+            --lambda_depth;
+        }
+
+        StructuralHash hash = StructuralHash::combine(node->token.type, key, left, right);
+        operands.push_back(hash);
+        nodes_.push_back(node);
+        hashes_.push_back(hash);
+        keys_.push_back(key);
+    }
+}
+
+std::string_view DeBruijnHashes::distanceName(size_t distance) {
+    while (distance_names_.size() <= distance) {
+        distance_names_.push_back("#" + std::to_string(distance_names_.size()));
+    }
+    return distance_names_[distance];
+}
+
+size_t DeBruijnHashes::size() const {
+    return nodes_.size();
+}
+
+const AST::NodePtr& DeBruijnHashes::node(size_t index) const {
+    return nodes_[index];
+}
+
+const StructuralHash& DeBruijnHashes::hash(size_t index) const {
+    return hashes_[index];
+}
+
+TokenView DeBruijnHashes::token(size_t index) const {
+    const Token& token = nodes_[index]->token;
+    return {token.type, keys_[index], keys_[index] == token.value ? token.symbol : kNoSymbol};
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ast.h"
+#include "structural_hash.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+class DeBruijnHashes {
+  public:
+    DeBruijnHashes() = default;
+    explicit DeBruijnHashes(const AST& ast);
+
+    size_t size() const;
+    const AST::NodePtr& node(size_t index) const;
+    const StructuralHash& hash(size_t index) const;
+    TokenView token(size_t index) const;
+
+  private:
+    std::vector<AST::NodePtr> nodes_;
+    std::vector<StructuralHash> hashes_;
+    std::vector<std::string_view> keys_;
+    std::deque<std::string> distance_names_;
+
+    std::string_view distanceName(size_t distance);
+};
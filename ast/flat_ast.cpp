@@ -0,0 +1,213 @@
+#include "flat_ast.h"
+#include <stdexcept>
+#include <utility>
+
+namespace {
+FlatAST::Opcode BinaryOpcode(std::string_view value) {
+    if (value == "+") {
+        return FlatAST::Opcode::Add;
+    }
+    if (value == "-") {
+        return FlatAST::Opcode::Subtract;
+    }
+    if (value == "*") {
+        return FlatAST::Opcode::Multiply;
+    }
+    if (value == "/") {
+        return FlatAST::Opcode::Divide;
+    }
+    if (value == "^") {
+        return FlatAST::Opcode::Power;
+    }
+    throw std::invalid_argument("Unsupported binary operator in FlatAST: " + std::string(value));
+}
+
+std::string_view OperatorSpelling(FlatAST::Opcode opcode) {
+    switch (opcode) {
+        case FlatAST::Opcode::Add:
+            return "+";
+        case FlatAST::Opcode::Subtract:
+            return "-";
+        case FlatAST::Opcode::Multiply:
+            return "*";
+        case FlatAST::Opcode::Divide:
+            return "/";
+        case FlatAST::Opcode::Power:
+            return "^";
+        default:
+            return "lambda";
+    }
+}
+}
+
+FlatAST::FlatAST(const AST& ast) {
+    AST::NodePtr root = ast.getRoot();
+    if (!root) {
+        return;
+    }
+
+    std::unordered_map<std::string, Index> literal_ids;
+    std::vector<Index> operands;
+    std::vector<std::pair<const AST::Node*, bool>> stack = {{root.get(), false}};
+    while (!stack.empty()) {
+        auto [node, expanded] = stack.back();
+        stack.pop_back();
+        if (!expanded) {
+            stack.push_back({node, true});
+            if (node->right) {
+                stack.push_back({node->right.get(), false});
+            }
+            if (node->left) {
+                stack.push_back({node->left.get(), false});
+            }
+            continue;
+        }
+        Index right = kNone;
+        Index left = kNone;
+        if (node->right) {
+            right = operands.back();
+            operands.pop_back();
+        }
+        if (node->left) {
+            left = operands.back();
+            operands.pop_back();
+        }
+        operands.push_back(append(*node, left, right, literal_ids));
+    }
+}
+
+FlatAST::Index FlatAST::append(const AST::Node& node, Index left, Index right,
+                               std::unordered_map<std::string, Index>& literal_ids) {
+    if (opcodes_.size() >= kNone) {
+        throw std::length_error("FlatAST cannot index this many nodes");
+    }
+    Index index = static_cast<Index>(opcodes_.size());
+    Index payload = kNone;
+    Opcode opcode;
+    switch (node.token.type) {
+        case TokenType::Number:
+        case TokenType::UnaryOperator: {
+            opcode = node.token.type == TokenType::Number ? Opcode::Number : Opcode::Function;
+            auto [it, inserted] = literal_ids.emplace(node.token.value, static_cast<Index>(literals_.size()));
+            if (inserted) {
+                literals_.push_back(node.token.value);
+            }
+            payload = it->second;
+            break;
+        }
+        case TokenType::ID:
+            opcode = Opcode::Identifier;
+            payload = node.token.symbol;
+            break;
+        case TokenType::BinaryOperator:
+            opcode = BinaryOpcode(node.token.value);
+            break;
+        case TokenType::Lambda:
+            opcode = Opcode::Lambda;
+            break;
+        default:
+            throw std::invalid_argument("Unsupported token in FlatAST: " + node.token.value);
+    }
+
+    opcodes_.push_back(opcode);
+    left_.push_back(left);
+    right_.push_back(right);
+    parent_.push_back(kNone);
+    payload_.push_back(payload);
+    begin_.push_back(left != kNone ? begin_[left] : right != kNone ? begin_[right] : index);
+    for (Index child : {left, right}) {
+        if (child != kNone) {
+            parent_[child] = index;
+        }
+    }
+    return index;
+}
+
+AST FlatAST::toAST(AST::Allocation allocation) const {
+    AST ast(allocation);
+    std::vector<AST::NodePtr> nodes(size());
+    for (Index i = 0; i < size(); ++i) {
+        AST::NodePtr left = left_[i] != kNone ? std::move(nodes[left_[i]]) : nullptr;
+        AST::NodePtr right = right_[i] != kNone ? std::move(nodes[right_[i]]) : nullptr;
+        nodes[i] = isLeaf(i) ? ast.makeLeaf(token(i)) : ast.makeNode(token(i), std::move(left), std::move(right));
+    }
+    if (!empty()) {
+        ast.setRoot(std::move(nodes.back()));
+    }
+    return ast;
+}
+
+size_t FlatAST::size() const {
+    return opcodes_.size();
+}
+
+bool FlatAST::empty() const {
+    return opcodes_.empty();
+}
+
+FlatAST::Index FlatAST::root() const {
+    return empty() ? kNone : static_cast<Index>(size() - 1);
+}
+
+FlatAST::Opcode FlatAST::opcode(Index node) const {
+    return opcodes_[node];
+}
+
+FlatAST::Index FlatAST::left(Index node) const {
+    return left_[node];
+}
+
+FlatAST::Index FlatAST::right(Index node) const {
+    return right_[node];
+}
+
+FlatAST::Index FlatAST::parent(Index node) const {
+    return parent_[node];
+}
+
+FlatAST::Index FlatAST::payload(Index node) const {
+    return payload_[node];
+}
+
+bool FlatAST::isLeaf(Index node) const {
+    return left_[node] == kNone && right_[node] == kNone;
+}
+
+FlatAST::Index FlatAST::subtreeBegin(Index node) const {
+    return begin_[node];
+}
+
+TokenView FlatAST::token(Index node) const {
+    switch (opcodes_[node]) {
+        case Opcode::Number:
+            return {TokenType::Number, literals_[payload_[node]]};
+        case Opcode::Function:
+            return {TokenType::UnaryOperator, literals_[payload_[node]]};
+        case Opcode::Identifier:
+            return {TokenType::ID, SymbolTable::global().name(payload_[node]), payload_[node]};
+        case Opcode::Lambda:
+            return {TokenType::Lambda, OperatorSpelling(opcodes_[node])};
+        default:
+            return {TokenType::BinaryOperator, OperatorSpelling(opcodes_[node])};
+    }
+}
+
+const std::vector<FlatAST::Opcode>& FlatAST::opcodes() const {
+    return opcodes_;
+}
+
+const std::vector<FlatAST::Index>& FlatAST::lefts() const {
+    return left_;
+}
+
+const std::vector<FlatAST::Index>& FlatAST::rights() const {
+    return right_;
+}
+
+const std::vector<FlatAST::Index>& FlatAST::parents() const {
+    return parent_;
+}
+
+const std::vector<FlatAST::Index>& FlatAST::payloads() const {
+    return payload_;
+}
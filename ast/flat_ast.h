@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ast.h"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class FlatAST {
+  public:
+    using Index = uint32_t;
+
+    static constexpr Index kNone = std::numeric_limits<Index>::max();
+
+    enum class Opcode : uint8_t {
+        Number,
+        Identifier,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        Function,
+        Lambda,
+    };
+
+    FlatAST() = default;
+    explicit FlatAST(const AST& ast);
+
+    AST toAST(AST::Allocation allocation = AST::Allocation::Heap) const;
+
+    size_t size() const;
+    bool empty() const;
+    Index root() const;
+
+    Opcode opcode(Index node) const;
+    Index left(Index node) const;
+    Index right(Index node) const;
+    Index parent(Index node) const;
+    Index payload(Index node) const;
+    bool isLeaf(Index node) const;
+    Index subtreeBegin(Index node) const;
+    TokenView token(Index node) const;
+
+    const std::vector<Opcode>& opcodes() const;
+    const std::vector<Index>& lefts() const;
+    const std::vector<Index>& rights() const;
+    const std::vector<Index>& parents() const;
+    const std::vector<Index>& payloads() const;
+
+  private:
+    std::vector<Opcode> opcodes_;
+    std::vector<Index> left_;
+    std::vector<Index> right_;
+    std::vector<Index> parent_;
+    std::vector<Index> payload_;
+    std::vector<Index> begin_;
+    std::vector<std::string> literals_;
+
+    Index append(const AST::Node& node, Index left, Index right,
+                 std::unordered_map<std::string, Index>& literal_ids);
+};
@@ -0,0 +1,63 @@
+#include "hash_cons_table.h"
+#include <functional>
+#include <utility>
+
+namespace {
+bool IsCommutative(TokenType type, std::string_view value) {
+    return type == TokenType::BinaryOperator && (value == "+" || value == "*");
+}
+
+size_t Combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+}
+
+bool HashConsTable::Key::operator==(const Key& other) const {
+    return type == other.type && left == other.left && right == other.right && value == other.value;
+}
+
+size_t HashConsTable::KeyHash::operator()(const Key& key) const {
+    size_t seed = std::hash<std::string_view>()(key.value);
+    seed = Combine(seed, static_cast<size_t>(key.type));
+    seed = Combine(seed, std::hash<const AST::Node*>()(key.left));
+    return Combine(seed, std::hash<const AST::Node*>()(key.right));
+}
+
+HashConsTable::Key HashConsTable::makeKey(TokenType type, std::string_view value,
+                                          const AST::Node* left, const AST::Node* right) {
+    if (IsCommutative(type, value) && std::less<const AST::Node*>()(right, left)) {
+        std::swap(left, right);
+    }
+    return {type, value, left, right};
+}
+
+const HashConsTable::Entry* HashConsTable::find(const AST::Node& node) const {
+    auto it = entries_.find(makeKey(node.token.type, node.token.value, node.left.get(), node.right.get()));
+    if (it == entries_.end() || it->second.node.get() != &node) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+size_t HashConsTable::occurrences(const AST::Node& node) const {
+    const Entry* entry = find(node);
+    return entry ? entry->occurrences : 0;
+}
+
+size_t HashConsTable::uniqueNodes() const {
+    return entries_.size();
+}
+
+size_t HashConsTable::totalNodes() const {
+    return total_nodes_;
+}
+
+std::vector<const HashConsTable::Entry*> HashConsTable::repeated(size_t min_occurrences) const {
+    std::vector<const Entry*> result;
+    for (const auto& [key, entry] : entries_) {
+        if (entry.occurrences >= min_occurrences) {
+            result.push_back(&entry);
+        }
+    }
+    return result;
+}
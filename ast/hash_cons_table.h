@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ast.h"
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class HashConsTable {
+  public:
+    struct Entry {
+        AST::NodePtr node;
+        size_t occurrences = 0;
+    };
+
+    template <typename Factory>
+    AST::NodePtr intern(const TokenView& token, const AST::NodePtr& left, const AST::NodePtr& right,
+                        Factory&& create);
+
+    const Entry* find(const AST::Node& node) const;
+    size_t occurrences(const AST::Node& node) const;
+    size_t uniqueNodes() const;
+    size_t totalNodes() const;
+    std::vector<const Entry*> repeated(size_t min_occurrences = 2) const;
+
+  private:
+    struct Key {
+        TokenType type;
+        std::string_view value;
+        const AST::Node* left;
+        const AST::Node* right;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    size_t total_nodes_ = 0;
+
+    static Key makeKey(TokenType type, std::string_view value, const AST::Node* left,
+                       const AST::Node* right);
+};
+
+template <typename Factory>
+AST::NodePtr HashConsTable::intern(const TokenView& token, const AST::NodePtr& left,
+                                   const AST::NodePtr& right, Factory&& create) {
+    ++total_nodes_;
+    Key key = makeKey(token.type, token.value, left.get(), right.get());
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        ++it->second.occurrences;
+        return it->second.node;
+    }
+    AST::NodePtr node = create();
+    key.value = node->token.value;
+    entries_.emplace(key, Entry{node, 1});
+    return node;
+}
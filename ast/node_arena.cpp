@@ -0,0 +1,26 @@
+#include "node_arena.h"
+
+std::shared_ptr<NodeArena> NodeArena::create(size_t initial_block_size) {
+    return std::shared_ptr<NodeArena>(new NodeArena(initial_block_size),
+                                      [](NodeArena* arena) { arena->release(); });
+}
+
+NodeArena::NodeArena(size_t initial_block_size)
+    : resource_(initial_block_size, std::pmr::new_delete_resource()) {}
+
+void* NodeArena::allocate(size_t bytes, size_t alignment) {
+    void* memory = resource_.allocate(bytes, alignment);
+    bytes_allocated_ += bytes;
+    references_.fetch_add(1, std::memory_order_relaxed);
+    return memory;
+}
+
+void NodeArena::release() noexcept {
+    if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+size_t NodeArena::bytesAllocated() const {
+    return bytes_allocated_;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+class NodeArena {
+  public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    static std::shared_ptr<NodeArena> create(size_t initial_block_size = kDefaultBlockSize);
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+    void release() noexcept;
+    size_t bytesAllocated() const;
+
+  private:
+    explicit NodeArena(size_t initial_block_size);
+    ~NodeArena() = default;
+
+    std::pmr::monotonic_buffer_resource resource_;
+    size_t bytes_allocated_ = 0;
+    std::atomic<size_t> references_{1};
+};
+
+template <typename T>
+class ArenaAllocator {
+  public:
+    using value_type = T;
+
+    explicit ArenaAllocator(NodeArena* arena) noexcept : arena_(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena_->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {
+        arena_->release();
+    }
+
+    NodeArena* arena() const {
+        return arena_;
+    }
+
+  private:
+    NodeArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+    return !(lhs == rhs);
+}
@@ -0,0 +1,169 @@
+#include "persistent_ast.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+PersistentAST::NodePtr CopyWithChildren(const Token& token, PersistentAST::NodePtr left,
+                                        PersistentAST::NodePtr right) {
+    return std::make_shared<PersistentAST::Node>(token, std::move(left), std::move(right));
+}
+}
+
+PersistentAST::Node::Node(Token token_value, NodePtr left_child, NodePtr right_child)
+    : token(std::move(token_value)), left(std::move(left_child)), right(std::move(right_child)) {
+    height = 1 + std::max(left ? left->height : 0, right ? right->height : 0);
+    node_count = 1 + (left ? left->node_count : 0) + (right ? right->node_count : 0);
+    hash = StructuralHash::combine(token.type, token.value, left ? left->hash : StructuralHash{},
+                                   right ? right->hash : StructuralHash{});
+}
+
+PersistentAST::Node::~Node() {
+    std::vector<std::shared_ptr<Node>> pending;
+    auto detach = [&pending](NodePtr& child) {
+        if (child && child.use_count() == 1) {
+            pending.push_back(std::const_pointer_cast<Node>(std::move(child)));
+        }
+        child.reset();
+    };
+    detach(left);
+    detach(right);
+    while (!pending.empty()) {
+        std::shared_ptr<Node> node = std::move(pending.back());
+        pending.pop_back();
+        detach(node->left);
+        detach(node->right);
+    }
+}
+
+bool PersistentAST::Node::isLeaf() const {
+    return !left && !right;
+}
+
+PersistentAST::Cursor::Cursor(const PersistentAST& ast) {
+    if (ast.root_) {
+        path_.push_back(ast.root_);
+    }
+}
+
+PersistentAST::Cursor::operator bool() const {
+    return !path_.empty();
+}
+
+const PersistentAST::Node& PersistentAST::Cursor::node() const {
+    return *path_.back();
+}
+
+const PersistentAST::NodePtr& PersistentAST::Cursor::handle() const {
+    return path_.back();
+}
+
+size_t PersistentAST::Cursor::depth() const {
+    return went_right_.size();
+}
+
+bool PersistentAST::Cursor::left() {
+    return !path_.empty() && descend(path_.back()->left, false);
+}
+
+bool PersistentAST::Cursor::right() {
+    return !path_.empty() && descend(path_.back()->right, true);
+}
+
+bool PersistentAST::Cursor::up() {
+    if (path_.size() < 2) {
+        return false;
+    }
+    path_.pop_back();
+    went_right_.pop_back();
+    return true;
+}
+
+bool PersistentAST::Cursor::descend(const NodePtr& child, bool right) {
+    if (!child) {
+        return false;
+    }
+    path_.push_back(child);
+    went_right_.push_back(right);
+    return true;
+}
+
+PersistentAST::PersistentAST(NodePtr root) : root_(std::move(root)) {}
+
+PersistentAST PersistentAST::fromAST(const AST& ast) {
+    std::vector<NodePtr> operands;
+    for (const AST::Node& node : ast.postOrder()) {
+        NodePtr right = node.right ? std::move(operands.back()) : nullptr;
+        if (node.right) {
+            operands.pop_back();
+        }
+        NodePtr left = node.left ? std::move(operands.back()) : nullptr;
+        if (node.left) {
+            operands.pop_back();
+        }
+        operands.push_back(CopyWithChildren(node.token, std::move(left), std::move(right)));
+    }
+    return PersistentAST(operands.empty() ? nullptr : std::move(operands.back()));
+}
+
+PersistentAST::NodePtr PersistentAST::makeLeaf(const TokenView& token) {
+    return std::make_shared<Node>(token.toToken(), nullptr, nullptr);
+}
+
+PersistentAST::NodePtr PersistentAST::makeNode(const TokenView& token, NodePtr left, NodePtr right) {
+    return std::make_shared<Node>(token.toToken(), std::move(left), std::move(right));
+}
+
+const PersistentAST::NodePtr& PersistentAST::root() const {
+    return root_;
+}
+
+bool PersistentAST::empty() const {
+    return root_ == nullptr;
+}
+
+size_t PersistentAST::nodeCount() const {
+    return root_ ? root_->node_count : 0;
+}
+
+PersistentAST::Cursor PersistentAST::cursor() const {
+    return Cursor(*this);
+}
+
+PersistentAST PersistentAST::replace(const Cursor& at, NodePtr subtree) const {
+    if (!at || at.path_.front() != root_) {
+        throw std::invalid_argument("Cursor does not belong to this version");
+    }
+    NodePtr replacement = std::move(subtree);
+    for (size_t i = at.depth(); i-- > 0;) {
+        const Node& parent = *at.path_[i];
+        if (at.went_right_[i]) {
+            replacement = CopyWithChildren(parent.token, parent.left, std::move(replacement));
+        } else {
+            replacement = CopyWithChildren(parent.token, std::move(replacement), parent.right);
+        }
+    }
+    return PersistentAST(std::move(replacement));
+}
+
+AST PersistentAST::toAST(AST::Allocation allocation) const {
+    AST ast(allocation);
+    std::vector<AST::NodePtr> operands;
+    for (const Node& node : PostOrderRange(root_)) {
+        AST::NodePtr right = node.right ? std::move(operands.back()) : nullptr;
+        if (node.right) {
+            operands.pop_back();
+        }
+        AST::NodePtr left = node.left ? std::move(operands.back()) : nullptr;
+        if (node.left) {
+            operands.pop_back();
+        }
+        TokenView token{node.token.type, node.token.value, node.token.symbol};
+        operands.push_back(node.isLeaf() ? ast.makeLeaf(token)
+                                         : ast.makeNode(token, std::move(left), std::move(right)));
+    }
+    if (!operands.empty()) {
+        ast.setRoot(std::move(operands.back()));
+    }
+    return ast;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ast.h"
+#include "structural_hash.h"
+#include "traversal.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class PersistentAST {
+  public:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    using PostOrderRange = TraversalRange<const Node, TraversalOrder::PostOrder>;
+
+    struct Node {
+        Token token;
+        NodePtr left;
+        NodePtr right;
+        size_t height = 1;
+        size_t node_count = 1;
+        StructuralHash hash;
+
+        Node(Token token_value, NodePtr left_child, NodePtr right_child);
+        ~Node();
+
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        bool isLeaf() const;
+    };
+
+    class Cursor {
+      public:
+        explicit Cursor(const PersistentAST& ast);
+
+        explicit operator bool() const;
+        const Node& node() const;
+        const NodePtr& handle() const;
+        size_t depth() const;
+
+        bool left();
+        bool right();
+        bool up();
+
+      private:
+        friend class PersistentAST;
+
+        std::vector<NodePtr> path_;
+        std::vector<bool> went_right_;
+
+        bool descend(const NodePtr& child, bool right);
+    };
+
+    PersistentAST() = default;
+    explicit PersistentAST(NodePtr root);
+
+    static PersistentAST fromAST(const AST& ast);
+    static NodePtr makeLeaf(const TokenView& token);
+    static NodePtr makeNode(const TokenView& token, NodePtr left, NodePtr right);
+
+    const NodePtr& root() const;
+    bool empty() const;
+    size_t nodeCount() const;
+    Cursor cursor() const;
+
+    PersistentAST replace(const Cursor& at, NodePtr subtree) const;
+    AST toAST(AST::Allocation allocation = AST::Allocation::Heap) const;
+
+  private:
+    NodePtr root_;
+};
@@ -0,0 +1,43 @@
+#include "structural_hash.h"
+#include <functional>
+#include <utility>
+
+namespace {
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+bool IsCommutative(TokenType type, std::string_view value) {
+    return type == TokenType::BinaryOperator && (value == "+" || value == "*");
+}
+}
+
+StructuralHash StructuralHash::combine(TokenType type, std::string_view value, StructuralHash left,
+                                       StructuralHash right) {
+    if (IsCommutative(type, value) && right < left) {
+        std::swap(left, right);
+    }
+    uint64_t seed = std::hash<std::string_view>()(value) ^ (static_cast<uint64_t>(type) << 56);
+    StructuralHash hash;
+    hash.low = Mix(seed ^ Mix(left.low + 0x9e3779b97f4a7c15ULL));
+    hash.low = Mix(hash.low ^ Mix(right.low + 0x632be59bd9b4e019ULL));
+    hash.high = Mix(Mix(seed + 0xd6e8feb86659fd93ULL) ^ Mix(left.high ^ 0xa0761d6478bd642fULL));
+    hash.high = Mix(hash.high ^ Mix(right.high + 0xe7037ed1a0b428dbULL));
+    return hash;
+}
+
+bool StructuralHash::operator==(const StructuralHash& other) const {
+    return low == other.low && high == other.high;
+}
+
+bool StructuralHash::operator!=(const StructuralHash& other) const {
+    return !(*this == other);
+}
+
+bool StructuralHash::operator<(const StructuralHash& other) const {
+    return high != other.high ? high < other.high : low < other.low;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../parser/tokenizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+struct StructuralHash {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    static StructuralHash combine(TokenType type, std::string_view value, StructuralHash left,
+                                  StructuralHash right);
+
+    bool operator==(const StructuralHash& other) const;
+    bool operator!=(const StructuralHash& other) const;
+    bool operator<(const StructuralHash& other) const;
+};
+
+struct StructuralHashHasher {
+    size_t operator()(const StructuralHash& hash) const {
+        return static_cast<size_t>(hash.low);
+    }
+};
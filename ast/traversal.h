@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+enum class TraversalOrder {
+    InOrder,
+    PostOrder,
+    PreOrder,
+    LevelOrder,
+};
+
+template <typename Node, TraversalOrder Order>
+class TraversalIterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Node;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Node*;
+    using reference = const Node&;
+    using Slot = std::shared_ptr<Node>;
+
+    TraversalIterator() = default;
+
+    explicit TraversalIterator(const Slot& root) {
+        if (!root) {
+            return;
+        }
+        if constexpr (Order == TraversalOrder::InOrder) {
+            descendLeft(&root);
+            pop();
+        } else if constexpr (Order == TraversalOrder::PostOrder) {
+            descendPostOrder(&root);
+            pop();
+        } else {
+            current_ = &root;
+        }
+    }
+
+    reference operator*() const {
+        return **current_;
+    }
+
+    pointer operator->() const {
+        return current_->get();
+    }
+
+    const Slot& handle() const {
+        return *current_;
+    }
+
+    TraversalIterator& operator++() {
+        const Node& node = **current_;
+        if constexpr (Order == TraversalOrder::InOrder) {
+            descendLeft(&node.right);
+        } else if constexpr (Order == TraversalOrder::PostOrder) {
+            if (!pending_.empty() && !pending_.back().expanded) {
+                pending_.back().expanded = true;
+                descendPostOrder(&(*pending_.back().slot)->right);
+            }
+        } else if constexpr (Order == TraversalOrder::PreOrder) {
+            push(&node.right);
+            push(&node.left);
+        } else {
+            push(&node.left);
+            push(&node.right);
+        }
+        pop();
+        return *this;
+    }
+
+    TraversalIterator operator++(int) {
+        TraversalIterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    bool operator==(const TraversalIterator& other) const {
+        return current_ == other.current_;
+    }
+
+    bool operator!=(const TraversalIterator& other) const {
+        return current_ != other.current_;
+    }
+
+  private:
+    struct Entry {
+        const Slot* slot;
+        bool expanded;
+    };
+
+    const Slot* current_ = nullptr;
+    std::vector<Entry> pending_;
+    size_t head_ = 0;
+
+    void push(const Slot* slot, bool expanded = true) {
+        if (*slot) {
+            pending_.push_back({slot, expanded});
+        }
+    }
+
+    void descendLeft(const Slot* slot) {
+        for (; *slot; slot = &(*slot)->left) {
+            push(slot);
+        }
+    }
+
+    void descendPostOrder(const Slot* slot) {
+        while (*slot) {
+            const Node& node = **slot;
+            if (node.left) {
+                push(slot, false);
+                slot = &node.left;
+            } else {
+                push(slot);
+                slot = &node.right;
+            }
+        }
+    }
+
+    void pop() {
+        if constexpr (Order == TraversalOrder::LevelOrder) {
+            if (head_ == pending_.size()) {
+                current_ = nullptr;
+                return;
+            }
+            current_ = pending_[head_++].slot;
+            if (head_ * 2 > pending_.size() && head_ >= 64) {
+                pending_.erase(pending_.begin(), pending_.begin() + static_cast<difference_type>(head_));
+                head_ = 0;
+            }
+        } else {
+            if (pending_.empty()) {
+                current_ = nullptr;
+                return;
+            }
+            current_ = pending_.back().slot;
+            pending_.pop_back();
+        }
+    }
+};
+
+template <typename Node, TraversalOrder Order>
+class TraversalRange {
+  public:
+    using iterator = TraversalIterator<Node, Order>;
+
+    explicit TraversalRange(const std::shared_ptr<Node>& root) : root_(&root) {}
+    explicit TraversalRange(const std::shared_ptr<Node>&& root) = delete;
+
+    iterator begin() const {
+        return iterator(*root_);
+    }
+
+    iterator end() const {
+        return iterator();
+    }
+
+  private:
+    const std::shared_ptr<Node>* root_;
+};
@@ -0,0 +1,872 @@
+#include "../analysis/corpus_subexpression_index.h"
+#include "../analysis/msp_checker.h"
+#include "../analysis/subexpression_finder.h"
+#include "../ast/ac_normal_form.h"
+#include "../ast/binary_ast.h"
+#include "../ast/canonical_text.h"
+#include "../ast/flat_ast.h"
+#include "../ast/persistent_ast.h"
+#include "../parser/batch_parser.h"
+#include "../parser/incremental_parser.h"
+#include "../parser/parser.h"
+#include "../parser/pda.h"
+#include "../parser/stream_tokenizer.h"
+#include "../parser/tokenizer.h"
+#include "../util/subtree_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Callable>
+double BestOfSeconds(int repetitions, Callable&& callable) {
+    double best = 0.0;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = Clock::now();
+        callable();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+void ReportThroughput(const std::string& name, size_t bytes, double seconds) {
+    double bytes_per_second = seconds > 0.0 ? static_cast<double>(bytes) / seconds : 0.0;
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(0) << bytes_per_second
+              << " bytes/s  (" << std::setprecision(1) << bytes_per_second / 1e6 << " MB/s)\n";
+}
+
+long PeakRssKiB() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+template <typename Callable>
+void RunIsolated(const std::string& name, Callable&& callable) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        long rss_before = PeakRssKiB();
+        auto start = Clock::now();
+        callable();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        long rss_after = PeakRssKiB();
+        std::cout << std::left << std::setw(40) << name << std::right
+                  << std::setw(10) << std::fixed << std::setprecision(3) << seconds * 1e3
+                  << " ms  peak RSS +" << (rss_after - rss_before) / 1024 << " MiB\n";
+        std::cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+std::string MakeBalancedInput(int depth, size_t& leaf_counter) {
+    if (depth == 0) {
+        ++leaf_counter;
+        return leaf_counter % 3 == 0 ? std::to_string(leaf_counter % 1000)
+                                     : std::string(1, static_cast<char>('a' + leaf_counter % 26));
+    }
+    static const char operators[] = {'+', '*', '-', '/'};
+    return "(" + MakeBalancedInput(depth - 1, leaf_counter) + " " + operators[depth % 4] + " " +
+           MakeBalancedInput(depth - 1, leaf_counter) + ")";
+}
+
+std::string MakeNumberHeavyInput(size_t terms) {
+    std::mt19937 rng(42);
+    const char operators[] = {'+', '-', '*', '/'};
+    std::string out;
+    for (size_t i = 0; i < terms; ++i) {
+        if (i != 0) {
+            out += ' ';
+            out += operators[rng() % 4];
+            out += ' ';
+        }
+        if (rng() % 5 == 0) {
+            out += static_cast<char>('a' + rng() % 26);
+            continue;
+        }
+        out += std::to_string(1 + rng() % 100000);
+        if (rng() % 2 == 0) {
+            out += '.';
+            out += std::to_string(rng() % 1000000);
+        }
+    }
+    return out;
+}
+
+size_t RegexBaselineTokenCount(std::string_view input) {
+    static const std::regex number_re(R"(^(0|[1-9][0-9]*)(\.[0-9]+)?$)");
+    size_t count = 0;
+    size_t index = 0;
+    while (true) {
+        while (index < input.size() && std::isspace(static_cast<unsigned char>(input[index]))) {
+            ++index;
+        }
+        if (index >= input.size()) {
+            return count + 1;
+        }
+        size_t start = index;
+        if (std::isdigit(static_cast<unsigned char>(input[index]))) {
+            bool has_dot = false;
+            while (index < input.size()) {
+                char ch = input[index];
+                if (std::isdigit(static_cast<unsigned char>(ch))) {
+                    ++index;
+                } else if (ch == '.' && !has_dot) {
+                    has_dot = true;
+                    ++index;
+                } else {
+                    break;
+                }
+            }
+            std::string num(input.substr(start, index - start));
+            if (!std::regex_match(num, number_re)) {
+                return count;
+            }
+        } else if (std::isalpha(static_cast<unsigned char>(input[index]))) {
+            while (index < input.size() && std::isalpha(static_cast<unsigned char>(input[index]))) {
+                ++index;
+            }
+        } else {
+            ++index;
+        }
+        ++count;
+    }
+}
+
+void BenchTokenizerThroughput() {
+    std::string input = MakeNumberHeavyInput(200000);
+    size_t tokens = 0;
+
+    double baseline = BestOfSeconds(3, [&] {
+        tokens = RegexBaselineTokenCount(input);
+    });
+    ReportThroughput("tokenizer/regex baseline", input.size(), baseline);
+
+    size_t view_tokens = 0;
+    double table_driven = BestOfSeconds(5, [&] {
+        Tokenizer tokenizer(input);
+        view_tokens = tokenizer.tokenizeAllViews().size();
+    });
+    ReportThroughput("tokenizer/table-driven views", input.size(), table_driven);
+
+    if (tokens != view_tokens) {
+        std::cout << "token count mismatch: " << tokens << " vs " << view_tokens << "\n";
+    }
+}
+
+void BenchStreamTokenizerThroughput() {
+    std::string input = MakeNumberHeavyInput(200000);
+    double seconds = BestOfSeconds(5, [&] {
+        std::istringstream stream(input);
+        StreamTokenizer tokenizer(stream);
+        while (tokenizer.nextTokenView().type != TokenType::EndOfFile) {
+        }
+    });
+    ReportThroughput("tokenizer/stream 64KiB chunks", input.size(), seconds);
+}
+
+void BenchAstConstruction() {
+    size_t leaves = 0;
+    std::string input = MakeBalancedInput(19, leaves);
+    std::cout << "ast build: " << 2 * leaves - 1 << " nodes\n";
+    for (AST::Allocation allocation : {AST::Allocation::Heap, AST::Allocation::Arena}) {
+        const char* label = allocation == AST::Allocation::Heap ? "ast/build+free heap" : "ast/build+free arena";
+        RunIsolated(label, [&] {
+            Parser parser(input);
+            AST ast = parser.buildAST(allocation);
+        });
+    }
+}
+
+std::vector<std::string> MakeExpressionCorpus(size_t count) {
+    std::vector<std::string> corpus;
+    corpus.reserve(count + 1);
+    size_t leaves = 0;
+    corpus.push_back(MakeBalancedInput(17, leaves));
+    for (size_t i = 0; i < count; ++i) {
+        corpus.push_back(MakeNumberHeavyInput(3 + i % 13));
+        if (i % 10 == 0) {
+            corpus.back() += " +";
+        }
+    }
+    return corpus;
+}
+
+void ReportMilliseconds(const std::string& name, double seconds) {
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(10) << std::fixed << std::setprecision(3) << seconds * 1e3 << " ms\n";
+}
+
+void BenchBatchParsing() {
+    std::vector<std::string> corpus = MakeExpressionCorpus(200000);
+    std::cout << "batch parse: " << corpus.size() << " expressions\n";
+
+    double serial = BestOfSeconds(3, [&] {
+        std::vector<AST> asts;
+        asts.reserve(corpus.size());
+        for (const auto& input : corpus) {
+            try {
+                Parser parser(input);
+                asts.push_back(parser.buildAST());
+            } catch (const ParserException&) {
+                asts.emplace_back();
+            }
+        }
+    });
+    ReportMilliseconds("batch/serial loop", serial);
+
+    size_t hardware = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < hardware; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(hardware);
+    for (size_t threads : thread_counts) {
+        BatchParser::Options options;
+        options.threads = threads;
+        BatchParser batch(options);
+        double seconds = BestOfSeconds(3, [&] { batch.parse(corpus); });
+        ReportMilliseconds("batch/pool " + std::to_string(threads) + " threads", seconds);
+    }
+}
+
+void BenchPdaVersusParser() {
+    size_t leaves = 0;
+    std::string balanced = MakeBalancedInput(17, leaves);
+    std::string flat = MakeNumberHeavyInput(200000);
+    for (const auto& [label, input] : {std::make_pair("balanced", &balanced),
+                                       std::make_pair("flat", &flat)}) {
+        double parser_seconds = BestOfSeconds(3, [&] {
+            Parser parser(*input);
+            AST ast = parser.buildAST(AST::Allocation::Arena);
+        });
+        ReportThroughput(std::string("parse/Parser ") + label, input->size(), parser_seconds);
+
+        double pda_seconds = BestOfSeconds(3, [&] {
+            Tokenizer tokenizer(*input);
+            PDA pda(tokenizer.tokenizeAllViews());
+            AST ast = pda.BuildAST(AST::Allocation::Arena);
+        });
+        ReportThroughput(std::string("parse/PDA ") + label, input->size(), pda_seconds);
+    }
+}
+
+void BenchIncrementalReparse() {
+    size_t leaves = 0;
+    std::string source = MakeBalancedInput(17, leaves);
+    std::cout << "incremental reparse: " << source.size() << " bytes\n";
+
+    double full = BestOfSeconds(3, [&] {
+        Parser parser(source);
+        AST ast = parser.buildAST(AST::Allocation::Arena);
+    });
+    ReportMilliseconds("reparse/full parse", full);
+
+    Parser parser(source);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    const size_t edits = 1000;
+    size_t reparsed = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < edits; ++i) {
+        size_t offset = source.find_first_of("abcdefghijklmnopqrstuvwxyz", (i * 7919) % source.size());
+        if (offset == std::string::npos) {
+            offset = source.find_first_of("abcdefghijklmnopqrstuvwxyz");
+        }
+        TextEdit edit{offset, 1, "(z * 2)"};
+        ReparseResult result = IncrementalParser::reparse(std::move(ast), source, edit);
+        reparsed += result.reparsed_bytes;
+        ast = std::move(result.ast);
+        source = std::move(result.source);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ReportMilliseconds("reparse/incremental per edit", seconds / edits);
+    std::cout << "reparse/average bytes re-lexed              " << reparsed / edits << "\n";
+}
+
+std::string MakeRepetitiveInput(int depth, size_t& term_counter) {
+    static const char* const kTerms[] = {"(a + b) * (c - d)", "(b + a) * (c - d)", "sqrt(a * b) ^ 2",
+                                         "(c - d) / (a + b)", "-(a * b + c)"};
+    if (depth == 0) {
+        return kTerms[(term_counter++ * 7) % 5];
+    }
+    std::string left = MakeRepetitiveInput(depth - 1, term_counter);
+    std::string right = MakeRepetitiveInput(depth - 1, term_counter);
+    return "(" + left + (depth % 2 == 0 ? " * " : " + ") + right + ")";
+}
+
+void BenchHashConsing() {
+    size_t terms = 0;
+    std::string input = MakeRepetitiveInput(16, terms);
+    std::cout << "hash-consing: " << input.size() << " bytes of repetitive input\n";
+    for (AST::Sharing sharing : {AST::Sharing::Tree, AST::Sharing::HashConsed}) {
+        const char* label = sharing == AST::Sharing::Tree ? "hashcons/build+find tree" : "hashcons/build+find dag";
+        RunIsolated(label, [&] {
+            Parser parser(input);
+            AST ast = parser.buildAST(AST::Allocation::Heap, sharing);
+            SubexpressionFinder finder;
+            finder.find(ast);
+        });
+    }
+}
+
+void BenchFlatAST() {
+    size_t leaves = 0;
+    std::string input = MakeBalancedInput(18, leaves);
+    Parser parser(input);
+    AST ast = parser.buildAST();
+    FlatAST flat(ast);
+    std::cout << "flat ast: " << flat.size() << " nodes\n";
+
+    size_t tree_height = 0;
+    size_t flat_height = 0;
+    ReportMilliseconds("flat/height tree", BestOfSeconds(5, [&] { tree_height = util::Height(ast.getRoot()); }));
+    ReportMilliseconds("flat/height flat", BestOfSeconds(5, [&] { flat_height = util::Height(flat, flat.root()); }));
+    ReportMilliseconds("flat/convert from AST", BestOfSeconds(3, [&] { FlatAST converted(ast); }));
+
+    SubexpressionFinder finder;
+    size_t tree_repeats = 0;
+    size_t flat_repeats = 0;
+    ReportMilliseconds("flat/finder tree", BestOfSeconds(3, [&] { tree_repeats = finder.find(ast).size(); }));
+    ReportMilliseconds("flat/finder flat", BestOfSeconds(3, [&] { flat_repeats = finder.find(flat).size(); }));
+
+    if (tree_height != flat_height || tree_repeats != flat_repeats) {
+        std::cout << "flat ast mismatch: height " << tree_height << " vs " << flat_height << ", repeats "
+                  << tree_repeats << " vs " << flat_repeats << "\n";
+    }
+}
+
+void BenchTraversals() {
+    size_t leaves = 0;
+    std::string input = MakeBalancedInput(19, leaves);
+    Parser parser(input);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    std::cout << "traversal: " << 2 * leaves - 1 << " nodes\n";
+
+    size_t vector_leaves = 0;
+    ReportMilliseconds("traversal/post-order vector", BestOfSeconds(5, [&] {
+        vector_leaves = 0;
+        for (const AST::NodePtr& node : ast.LRCTraversal()) {
+            vector_leaves += node->isLeaf() ? 1 : 0;
+        }
+    }));
+    size_t range_leaves = 0;
+    ReportMilliseconds("traversal/post-order range", BestOfSeconds(5, [&] {
+        range_leaves = 0;
+        for (const AST::Node& node : ast.postOrder()) {
+            range_leaves += node.isLeaf() ? 1 : 0;
+        }
+    }));
+
+    if (vector_leaves != range_leaves) {
+        std::cout << "traversal mismatch: " << vector_leaves << " vs " << range_leaves << "\n";
+    }
+}
+
+void BenchBinaryReload() {
+    size_t leaves = 0;
+    std::string input = MakeBalancedInput(22, leaves);
+    std::string path = "lab2_bench_ast.bin";
+    std::cout << "binary reload: " << 2 * leaves - 1 << " nodes\n";
+
+    double parse = BestOfSeconds(1, [&] {
+        Parser parser(input);
+        AST ast = parser.buildAST(AST::Allocation::Arena);
+    });
+    ReportMilliseconds("binary/tokenize+parse", parse);
+
+    {
+        Parser parser(input);
+        AST ast = parser.buildAST(AST::Allocation::Arena);
+        ReportMilliseconds("binary/encode+save", BestOfSeconds(1, [&] { BinaryAST::save(ast, path); }));
+    }
+
+    size_t nodes = 0;
+    ReportMilliseconds("binary/mmap load", BestOfSeconds(3, [&] {
+        BinaryAST loaded(path);
+        nodes = loaded.nodeCount();
+    }));
+    size_t walked = 0;
+    ReportMilliseconds("binary/load+walk in place", BestOfSeconds(3, [&] {
+        BinaryAST loaded(path);
+        walked = 0;
+        std::vector<BinaryAST::Node> pending = {loaded.root()};
+        while (!pending.empty()) {
+            BinaryAST::Node node = pending.back();
+            pending.pop_back();
+            ++walked;
+            for (BinaryAST::Node child : {node.right(), node.left()}) {
+                if (child) {
+                    pending.push_back(child);
+                }
+            }
+        }
+    }));
+    std::remove(path.c_str());
+
+    if (nodes != walked) {
+        std::cout << "binary node count mismatch: " << nodes << " vs " << walked << "\n";
+    }
+}
+
+void BenchAnalysisQueries() {
+    size_t leaves = 0;
+    std::string input = "lambda x. " + MakeBalancedInput(19, leaves);
+    Parser parser(input);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    std::cout << "analysis: " << 2 * leaves + 1 << " nodes\n";
+
+    size_t closed = 0;
+    ReportMilliseconds("analysis/maximally closed", BestOfSeconds(3, [&] {
+        closed = MSPChecker().FindMaximallyClosed(ast).size();
+    }));
+    size_t queries = 0;
+    ReportMilliseconds("analysis/height+count every node", BestOfSeconds(3, [&] {
+        queries = 0;
+        AST::PreOrderRange nodes = ast.preOrder();
+        for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+            queries += util::Height(it.handle()) + util::NodeCount(it.handle()) > 0 ? 1 : 0;
+        }
+    }));
+
+    if (closed == 0 || queries != 2 * leaves + 1) {
+        std::cout << "analysis mismatch: " << closed << " closed, " << queries << " queries\n";
+    }
+}
+
+std::string MakeRepeatedTerms(int depth, std::mt19937& rng) {
+    if (depth == 0) {
+        return "(sin(a) * " + std::to_string(rng() % 20000) + " - b)";
+    }
+    return "(" + MakeRepeatedTerms(depth - 1, rng) + (depth % 2 == 0 ? " + " : " * ") +
+           MakeRepeatedTerms(depth - 1, rng) + ")";
+}
+
+void BenchTopKQuery() {
+    std::mt19937 rng(42);
+    Parser parser(MakeRepeatedTerms(17, rng));
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    CanonicalText text(ast.getRoot());
+    std::cout << "top-k query: " << util::NodeCount(ast.getRoot()) << " nodes\n";
+
+    SubexpressionFinder finder;
+    SubexpressionFinder::Query query;
+    query.min_height = 2;
+    query.top_k = 20;
+    query.max_occurrences = 1;
+    query.ranking = SubexpressionFinder::Ranking::Savings;
+    size_t reported = 0;
+    size_t kept = 0;
+    ReportMilliseconds("query/find + filter", BestOfSeconds(3, [&] {
+        std::vector<RepeatedSubexpression> all = finder.find(ast, text);
+        reported = all.size();
+        kept = std::count_if(all.begin(), all.end(), [](const auto& item) { return item.height >= 2; });
+    }));
+    std::vector<RepeatedSubexpression> top;
+    ReportMilliseconds("query/top 20 by savings", BestOfSeconds(3, [&] { top = finder.find(ast, text, query); }));
+    std::cout << "repeated groups: " << reported << ", " << kept << " above leaves, top " << top.size() << "\n";
+    if (top.size() != std::min<size_t>(20, kept)) {
+        std::cout << "top-k query mismatch: " << top.size() << " vs " << kept << "\n";
+    }
+}
+
+void BenchPersistentVersions() {
+    const int depth = 14;
+    size_t leaves = 0;
+    std::string input = MakeBalancedInput(depth, leaves);
+    Parser parser(input);
+    AST ast = parser.buildAST();
+    const size_t versions = 100;
+    std::cout << "persistent versions: " << versions << " edits of a " << 2 * leaves - 1 << "-node tree\n";
+
+    auto leaf_path = [depth](size_t version) {
+        std::vector<bool> path;
+        for (int bit = 0; bit < depth; ++bit) {
+            path.push_back(((version * 2654435761u) >> bit) & 1);
+        }
+        return path;
+    };
+
+    RunIsolated("persistent/deep copy per version", [&] {
+        std::vector<AST> history;
+        history.push_back(PersistentAST::fromAST(ast).toAST());
+        for (size_t version = 1; version < versions; ++version) {
+            AST copy = PersistentAST::fromAST(history.back()).toAST();
+            AST::Node* node = copy.getRoot().get();
+            for (bool right : leaf_path(version)) {
+                node = right ? node->right.get() : node->left.get();
+            }
+            node->token.value = std::to_string(version);
+            history.push_back(std::move(copy));
+        }
+    });
+    RunIsolated("persistent/path copy per version", [&] {
+        std::vector<PersistentAST> history = {PersistentAST::fromAST(ast)};
+        for (size_t version = 1; version < versions; ++version) {
+            PersistentAST::Cursor cursor = history.back().cursor();
+            for (bool right : leaf_path(version)) {
+                right ? cursor.right() : cursor.left();
+            }
+            TokenView leaf{TokenType::Number, std::to_string(version)};
+            history.push_back(history.back().replace(cursor, PersistentAST::makeLeaf(leaf)));
+        }
+    });
+}
+
+void BenchCanonicalText() {
+    size_t leaves = 0;
+    std::string chain = "x";
+    for (size_t i = 0; i < 10000; ++i) {
+        chain += i % 2 == 0 ? " + y" : " - x";
+    }
+    for (const std::string& input : {MakeBalancedInput(18, leaves), chain}) {
+        Parser parser(input);
+        AST ast = parser.buildAST(AST::Allocation::Arena);
+        FlatAST flat(ast);
+        std::cout << "canonical text: " << flat.size() << " nodes, height " << ast.height() << "\n";
+
+        size_t flat_bytes = 0;
+        ReportMilliseconds("canonical/flat root printed", BestOfSeconds(3, [&] {
+            flat_bytes = util::CanonicalForm(flat, flat.root()).size();
+        }));
+        size_t root_bytes = 0;
+        ReportMilliseconds("canonical/root printed", BestOfSeconds(3, [&] {
+            root_bytes = CanonicalText::print(*ast.getRoot()).size();
+        }));
+        size_t printed_bytes = 0;
+        ReportMilliseconds("canonical/every node printed", BestOfSeconds(3, [&] {
+            printed_bytes = 0;
+            for (const AST::Node& node : ast.postOrder()) {
+                printed_bytes += CanonicalText::print(node).size();
+            }
+        }));
+        size_t span_bytes = 0;
+        ReportMilliseconds("canonical/every node from one buffer", BestOfSeconds(3, [&] {
+            CanonicalText text(ast.getRoot());
+            span_bytes = 0;
+            for (const AST::Node& node : ast.postOrder()) {
+                span_bytes += text.of(node).size();
+            }
+        }));
+
+        if (flat_bytes != root_bytes || printed_bytes != span_bytes) {
+            std::cout << "canonical text mismatch: " << flat_bytes << " vs " << root_bytes << ", " << printed_bytes
+                      << " vs " << span_bytes << "\n";
+        }
+    }
+}
+
+std::string MakeReassociatedInput(size_t terms, std::mt19937& rng) {
+    if (terms == 1) {
+        std::string letters = "abcdefgh";
+        std::shuffle(letters.begin(), letters.end(), rng);
+        std::string term(1, letters[0]);
+        size_t operands = 3 + rng() % 3;
+        for (size_t i = 1; i < operands; ++i) {
+            std::string operand(1, letters[i]);
+            term = rng() % 2 == 0 ? "(" + term + " + " + operand + ")" : "(" + operand + " + " + term + ")";
+        }
+        return term;
+    }
+    std::string left = MakeReassociatedInput(terms / 2, rng);
+    return "(" + left + (terms % 2 == 0 ? " - " : " / ") + MakeReassociatedInput(terms - terms / 2, rng) + ")";
+}
+
+void BenchACNormalForm() {
+    std::mt19937 rng(42);
+    std::string input = MakeReassociatedInput(20000, rng);
+    Parser parser(input);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    std::cout << "ac normal form: " << util::NodeCount(ast.getRoot()) << " nodes\n";
+
+    SubexpressionFinder finder;
+    size_t tree_shared = 0;
+    ReportMilliseconds("ac/binary finder", BestOfSeconds(3, [&] {
+        tree_shared = 0;
+        for (const RepeatedSubexpression& item : finder.find(ast)) {
+            tree_shared += item.height > 1 ? item.count : 0;
+        }
+    }));
+    ReportMilliseconds("ac/normalize", BestOfSeconds(3, [&] { ACNormalForm form(ast); }));
+    ACNormalForm form(ast);
+    size_t whole_shared = 0;
+    size_t partial_shared = 0;
+    ReportMilliseconds("ac/finder", BestOfSeconds(3, [&] {
+        whole_shared = 0;
+        partial_shared = 0;
+        for (const ACRepeatedSubexpression& item : finder.find(form)) {
+            (item.partial ? partial_shared : whole_shared) += item.height > 1 ? item.count : 0;
+        }
+    }));
+    std::cout << "shared operator occurrences: binary " << tree_shared << ", ac whole " << whole_shared
+              << ", ac operand sets " << partial_shared << "\n";
+}
+
+void BenchOperandSetScaling() {
+    SubexpressionFinder finder;
+    for (size_t terms : {1000, 2000, 4000, 8000}) {
+        std::string input = "(x + y + 1)";
+        for (size_t i = 2; i <= terms; ++i) {
+            input += " * (x + y + " + std::to_string(i) + ")";
+        }
+        Parser parser(input);
+        ACNormalForm form(parser.buildAST(AST::Allocation::Arena));
+        size_t reported = 0;
+        ReportMilliseconds("ac/shared operand pair x" + std::to_string(terms),
+                           BestOfSeconds(3, [&] { reported = finder.find(form).size(); }));
+        if (reported == 0) {
+            std::cout << "operand set scaling mismatch: nothing reported for " << terms << " terms\n";
+        }
+    }
+}
+
+std::string MakeRenamedLambdas(size_t terms, std::mt19937& rng) {
+    if (terms == 1) {
+        std::string outer(1, static_cast<char>('a' + rng() % 13));
+        std::string inner(1, static_cast<char>('n' + rng() % 13));
+        return "(lambda " + outer + ". lambda " + inner + ". " + outer + " * " + inner + " - " +
+               std::to_string(rng() % 4) + ")";
+    }
+    std::string left = MakeRenamedLambdas(terms / 2, rng);
+    return "(" + left + " + " + MakeRenamedLambdas(terms - terms / 2, rng) + ")";
+}
+
+void BenchAlphaEquivalence() {
+    std::mt19937 rng(42);
+    Parser parser(MakeRenamedLambdas(50000, rng));
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    std::cout << "alpha equivalence: " << util::NodeCount(ast.getRoot()) << " nodes\n";
+
+    for (auto equivalence : {SubexpressionFinder::Equivalence::Structural, SubexpressionFinder::Equivalence::Alpha}) {
+        bool alpha = equivalence == SubexpressionFinder::Equivalence::Alpha;
+        SubexpressionFinder finder(equivalence);
+        std::vector<RepeatedSubexpression> repeated;
+        ReportMilliseconds(alpha ? "alpha/finder de Bruijn" : "alpha/finder structural",
+                           BestOfSeconds(3, [&] { repeated = finder.find(ast); }));
+        std::cout << "repeated groups: " << repeated.size() << ", tallest height "
+                  << (repeated.empty() ? 0 : repeated.front().height) << "\n";
+    }
+}
+
+void BenchMaximalSelection() {
+    std::string chain = "a * b";
+    for (size_t i = 0; i < 20000; ++i) {
+        chain += i % 2 == 0 ? " + c * d" : " - a * b";
+    }
+    Parser parser("(" + chain + ") / (" + chain + ")");
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    FlatAST flat(ast);
+    std::cout << "maximal selection: two " << flat.size() / 2 << "-node chains, height " << ast.height() << "\n";
+
+    SubexpressionFinder finder;
+    size_t tree_repeats = 0;
+    size_t flat_repeats = 0;
+    ReportMilliseconds("maximal/finder tree", BestOfSeconds(3, [&] { tree_repeats = finder.find(ast).size(); }));
+    ReportMilliseconds("maximal/finder flat", BestOfSeconds(3, [&] { flat_repeats = finder.find(flat).size(); }));
+    if (tree_repeats != flat_repeats) {
+        std::cout << "maximal selection mismatch: " << tree_repeats << " vs " << flat_repeats << "\n";
+    }
+}
+
+void BenchParallelFinder() {
+    size_t leaves = 0;
+    size_t terms = 0;
+    std::vector<std::pair<std::string, std::string>> inputs = {{"balanced", MakeBalancedInput(20, leaves)},
+                                                               {"repetitive", MakeRepetitiveInput(17, terms)}};
+    for (const auto& [name, input] : inputs) {
+        Parser parser(input);
+        AST ast = parser.buildAST(AST::Allocation::Arena);
+        std::cout << "parallel finder, " << name << ": " << util::NodeCount(ast.getRoot()) << " nodes, "
+                  << std::thread::hardware_concurrency() << " hardware threads\n";
+
+        size_t serial_groups = SubexpressionFinder().find(ast).size();
+        for (size_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+            SubexpressionFinder finder(
+                SubexpressionFinder::Options{SubexpressionFinder::Equivalence::Structural, threads});
+            size_t groups = 0;
+            ReportMilliseconds("parallel/" + name + " " + std::to_string(threads) + " threads",
+                               BestOfSeconds(3, [&] { groups = finder.find(ast).size(); }));
+            if (groups != serial_groups) {
+                std::cout << "parallel finder mismatch: " << groups << " vs " << serial_groups << "\n";
+            }
+        }
+    }
+}
+
+std::vector<std::string> MakeSkewedCorpus(size_t count, std::mt19937& rng) {
+    std::vector<std::string> terms;
+    for (size_t i = 0; i < 2000; ++i) {
+        terms.push_back("sin(x * " + std::to_string(i) + ") - y ^ " + std::to_string(i % 7));
+    }
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (size_t i = 0; i < count; ++i) {
+        size_t first = static_cast<size_t>(std::pow(uniform(rng), 3.0) * terms.size());
+        size_t second = static_cast<size_t>(std::pow(uniform(rng), 3.0) * terms.size());
+        corpus.push_back("(" + terms[first] + ") * (" + terms[second] + ") + " + std::to_string(i));
+    }
+    return corpus;
+}
+
+void BenchCorpusIndex() {
+    std::mt19937 rng(42);
+    std::vector<std::string> corpus = MakeSkewedCorpus(200000, rng);
+    std::vector<AST> asts;
+    asts.reserve(corpus.size());
+    for (const auto& input : corpus) {
+        Parser parser(input);
+        asts.push_back(parser.buildAST(AST::Allocation::Arena));
+    }
+    std::cout << "corpus index: " << asts.size() << " expressions\n";
+
+    std::unordered_map<StructuralHash, size_t, StructuralHashHasher> exact;
+    ReportMilliseconds("corpus/exact hash map", BestOfSeconds(3, [&] {
+        exact.clear();
+        for (const AST& ast : asts) {
+            for (const AST::Node& node : ast.postOrder()) {
+                if (node.height >= 2) {
+                    ++exact[node.hash];
+                }
+            }
+        }
+    }));
+    std::cout << "exact map: " << exact.size() << " keys, ~"
+              << exact.size() * (sizeof(std::pair<const StructuralHash, size_t>) + 2 * sizeof(void*)) / 1024
+              << " KiB\n";
+
+    CorpusSubexpressionIndex index;
+    ReportMilliseconds("corpus/count-min + top-K", BestOfSeconds(3, [&] {
+        index = CorpusSubexpressionIndex();
+        for (const AST& ast : asts) {
+            index.add(ast);
+        }
+    }));
+    std::cout << "sketch: ~" << index.memoryBytes() / 1024 << " KiB, error bound " << index.errorBound()
+              << " at confidence " << index.confidence() << "\n";
+
+    std::vector<std::pair<size_t, StructuralHash>> ranked;
+    for (const auto& [hash, count] : exact) {
+        ranked.push_back({count, hash});
+    }
+    std::partial_sort(ranked.begin(), ranked.begin() + 20, ranked.end(),
+                      [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+    std::unordered_map<StructuralHash, std::string, StructuralHashHasher> labels;
+    for (size_t i = 0; i < 20; ++i) {
+        labels[ranked[i].second];
+    }
+    std::unordered_map<std::string, size_t> exact_top;
+    for (const AST& ast : asts) {
+        AST::PostOrderRange nodes = ast.postOrder();
+        for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+            auto label = labels.find(it->hash);
+            if (label != labels.end() && label->second.empty()) {
+                label->second = util::CanonicalForm(it.handle());
+                exact_top[label->second] = exact[it->hash];
+            }
+        }
+    }
+
+    size_t recalled = 0;
+    size_t worst = 0;
+    for (const RepeatedSubexpression& item : index.top(20)) {
+        auto found = exact_top.find(item.canonical);
+        if (found != exact_top.end()) {
+            ++recalled;
+            worst = std::max(worst, item.count - found->second);
+        }
+    }
+    std::cout << "top-20 recall " << recalled << "/20, largest overestimate " << worst << "\n";
+    if (worst > index.errorBound()) {
+        std::cout << "corpus index exceeded its error bound\n";
+    }
+}
+
+void BenchErrorReporting() {
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < 200000; ++i) {
+        corpus.push_back(MakeNumberHeavyInput(2 + i % 5));
+        if (i % 10 < 3) {
+            corpus.back() += i % 2 == 0 ? " * )" : " + $";
+        }
+    }
+    std::cout << "error reporting: " << corpus.size() << " expressions, 30% invalid\n";
+
+    size_t thrown = 0;
+    double exceptions = BestOfSeconds(3, [&] {
+        thrown = 0;
+        for (const auto& input : corpus) {
+            try {
+                Parser parser(input);
+                parser.buildAST();
+            } catch (const ParserException&) {
+                ++thrown;
+            }
+        }
+    });
+    ReportMilliseconds("errors/buildAST + catch", exceptions);
+
+    size_t failed = 0;
+    double results = BestOfSeconds(3, [&] {
+        failed = 0;
+        for (const auto& input : corpus) {
+            Parser parser(input);
+            failed += parser.tryBuildAST().ok() ? 0 : 1;
+        }
+    });
+    ReportMilliseconds("errors/tryBuildAST", results);
+    if (thrown != failed) {
+        std::cout << "error count mismatch: " << thrown << " vs " << failed << "\n";
+    }
+}
+
+}  // namespace
+
+int main() {
+    BenchTokenizerThroughput();
+    BenchStreamTokenizerThroughput();
+    BenchAstConstruction();
+    BenchPdaVersusParser();
+    BenchBatchParsing();
+    BenchIncrementalReparse();
+    BenchHashConsing();
+    BenchFlatAST();
+    BenchMaximalSelection();
+    BenchParallelFinder();
+    BenchTraversals();
+    BenchBinaryReload();
+    BenchAnalysisQueries();
+    BenchTopKQuery();
+    BenchPersistentVersions();
+    BenchCanonicalText();
+    BenchACNormalForm();
+    BenchOperandSetScaling();
+    BenchAlphaEquivalence();
+    BenchCorpusIndex();
+    BenchErrorReporting();
+    return 0;
+}
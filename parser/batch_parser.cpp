@@ -0,0 +1,76 @@
+#include "batch_parser.h"
+#include "parser.h"
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+namespace {
+constexpr size_t kMinArenaBlock = 256;
+constexpr size_t kArenaBlockPerInputByte = 16;
+
+ParseResult ParseOne(std::string_view input, AST::Allocation allocation) {
+    Parser parser(std::make_unique<Tokenizer>(input));
+    if (allocation == AST::Allocation::Heap) {
+        return parser.tryBuildAST();
+    }
+    size_t block = std::clamp(input.size() * kArenaBlockPerInputByte, kMinArenaBlock, NodeArena::kDefaultBlockSize);
+    return parser.tryBuildAST(NodeArena::create(block));
+}
+}
+
+BatchParser::BatchParser() : BatchParser(Options{}) {}
+
+BatchParser::BatchParser(const Options& options)
+    : options_(options), pool_(options.threads) {}
+
+size_t BatchParser::threadCount() const {
+    return pool_.threadCount();
+}
+
+std::vector<ParseResult> BatchParser::parse(const std::vector<std::string>& inputs) {
+    std::vector<std::string_view> views(inputs.begin(), inputs.end());
+    return parseViews(views.data(), views.size());
+}
+
+std::vector<ParseResult> BatchParser::parse(const std::vector<std::string_view>& inputs) {
+    return parseViews(inputs.data(), inputs.size());
+}
+
+std::vector<ParseResult> BatchParser::parseViews(const std::string_view* inputs,
+                                                      size_t count) {
+    std::vector<ParseResult> results(count);
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [inputs](size_t lhs, size_t rhs) {
+        return inputs[lhs].size() > inputs[rhs].size();
+    });
+
+    std::vector<Task> tasks = schedule(order, inputs);
+    pool_.run(tasks.size(), [&](size_t task, size_t) {
+        for (size_t i = tasks[task].begin; i < tasks[task].end; ++i) {
+            size_t index = order[i];
+            results[index] = ParseOne(inputs[index], options_.allocation);
+        }
+    });
+    return results;
+}
+
+std::vector<BatchParser::Task> BatchParser::schedule(const std::vector<size_t>& order,
+                                                     const std::string_view* inputs) const {
+    std::vector<Task> tasks;
+    size_t i = 0;
+    while (i < order.size() && inputs[order[i]].size() >= options_.large_input_bytes) {
+        tasks.push_back({i, i + 1});
+        ++i;
+    }
+    while (i < order.size()) {
+        size_t begin = i;
+        size_t bytes = 0;
+        while (i < order.size() && (i == begin || bytes < options_.batch_bytes)) {
+            bytes += inputs[order[i]].size() + 1;
+            ++i;
+        }
+        tasks.push_back({begin, i});
+    }
+    return tasks;
+}
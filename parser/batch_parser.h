@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../ast/ast.h"
+#include "../util/work_stealing_pool.h"
+#include "parse_result.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class BatchParser {
+  public:
+    struct Options {
+        size_t threads = 0;
+        AST::Allocation allocation = AST::Allocation::Arena;
+        size_t large_input_bytes = 64 * 1024;
+        size_t batch_bytes = 16 * 1024;
+    };
+
+    BatchParser();
+    explicit BatchParser(const Options& options);
+
+    size_t threadCount() const;
+    std::vector<ParseResult> parse(const std::vector<std::string>& inputs);
+    std::vector<ParseResult> parse(const std::vector<std::string_view>& inputs);
+
+  private:
+    struct Task {
+        size_t begin;
+        size_t end;
+    };
+
+    Options options_;
+    util::WorkStealingPool pool_;
+
+    std::vector<ParseResult> parseViews(const std::string_view* inputs, size_t count);
+    std::vector<Task> schedule(const std::vector<size_t>& order,
+                               const std::string_view* inputs) const;
+};
@@ -0,0 +1,141 @@
+#include "char_class.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace lexer {
+
+namespace {
+enum NumberState : uint8_t {
+    kStart,
+    kZero,
+    kInteger,
+    kDot,
+    kFraction,
+    kReject,
+    kNumberStateCount,
+};
+
+enum NumberInput : uint8_t {
+    kInputZero,
+    kInputDigit,
+    kInputDot,
+    kInputOther,
+    kNumberInputCount,
+};
+
+constexpr std::array<NumberInput, 256> MakeNumberInputTable() {
+    std::array<NumberInput, 256> table{};
+    for (size_t ch = 0; ch < table.size(); ++ch) {
+        switch (kCharClass[ch]) {
+            case CharClass::Zero:
+                table[ch] = kInputZero;
+                break;
+            case CharClass::Digit:
+                table[ch] = kInputDigit;
+                break;
+            case CharClass::Dot:
+                table[ch] = kInputDot;
+                break;
+            default:
+                table[ch] = kInputOther;
+                break;
+        }
+    }
+    return table;
+}
+
+constexpr std::array<NumberInput, 256> kNumberInput = MakeNumberInputTable();
+
+constexpr uint8_t kNumberTransitions[kNumberStateCount][kNumberInputCount] = {
+    {kZero, kInteger, kReject, kReject},
+    {kReject, kReject, kDot, kReject},
+    {kInteger, kInteger, kDot, kReject},
+    {kFraction, kFraction, kReject, kReject},
+    {kFraction, kFraction, kReject, kReject},
+    {kReject, kReject, kReject, kReject},
+};
+
+constexpr bool kNumberAccepting[kNumberStateCount] = {
+    false, true, true, false, true, false,
+};
+
+#if defined(__SSE2__)
+inline __m128i LoadBlock(const char* data) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline __m128i InRange(__m128i block, char low, char span) {
+    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(span)), shifted);
+}
+
+inline unsigned StopMask(__m128i matches) {
+    return ~static_cast<unsigned>(_mm_movemask_epi8(matches)) & 0xFFFFu;
+}
+#endif
+}
+
+size_t SkipSpaces(std::string_view text, size_t index) {
+#if defined(__SSE2__)
+    while (index + 16 <= text.size()) {
+        __m128i block = LoadBlock(text.data() + index);
+        __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                                      InRange(block, '\t', '\r' - '\t'));
+        unsigned stop = StopMask(spaces);
+        if (stop != 0) {
+            return index + static_cast<size_t>(__builtin_ctz(stop));
+        }
+        index += 16;
+    }
+#endif
+    while (index < text.size() && IsSpace(text[index])) {
+        ++index;
+    }
+    return index;
+}
+
+size_t ScanDigits(std::string_view text, size_t index) {
+#if defined(__SSE2__)
+    while (index + 16 <= text.size()) {
+        unsigned stop = StopMask(InRange(LoadBlock(text.data() + index), '0', 9));
+        if (stop != 0) {
+            return index + static_cast<size_t>(__builtin_ctz(stop));
+        }
+        index += 16;
+    }
+#endif
+    while (index < text.size() && IsDigit(text[index])) {
+        ++index;
+    }
+    return index;
+}
+
+size_t ScanAlpha(std::string_view text, size_t index) {
+    while (index < text.size() && IsAlpha(text[index])) {
+        ++index;
+    }
+    return index;
+}
+
+size_t ScanNumber(std::string_view text, size_t index) {
+    index = ScanDigits(text, index);
+    if (index < text.size() && ClassOf(text[index]) == CharClass::Dot) {
+        index = ScanDigits(text, index + 1);
+    }
+    return index;
+}
+
+bool IsNumberLiteral(std::string_view text) {
+    uint8_t state = kStart;
+    for (char ch : text) {
+        state = kNumberTransitions[state][kNumberInput[static_cast<unsigned char>(ch)]];
+    }
+    return kNumberAccepting[state];
+}
+
+bool IsIdentifierWord(std::string_view text) {
+    return !text.empty() && ScanAlpha(text, 0) == text.size();
+}
+
+}
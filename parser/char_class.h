@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+enum class CharClass : uint8_t {
+    Other,
+    Space,
+    Alpha,
+    Zero,
+    Digit,
+    Dot,
+    Operator,
+    OpenScope,
+    CloseScope,
+};
+
+namespace lexer {
+
+constexpr std::array<CharClass, 256> MakeCharClassTable() {
+    std::array<CharClass, 256> table{};
+    for (auto& entry : table) {
+        entry = CharClass::Other;
+    }
+    for (unsigned char ch : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[ch] = CharClass::Space;
+    }
+    for (unsigned char ch = 'a'; ch <= 'z'; ++ch) {
+        table[ch] = CharClass::Alpha;
+    }
+    for (unsigned char ch = 'A'; ch <= 'Z'; ++ch) {
+        table[ch] = CharClass::Alpha;
+    }
+    table['0'] = CharClass::Zero;
+    for (unsigned char ch = '1'; ch <= '9'; ++ch) {
+        table[ch] = CharClass::Digit;
+    }
+    table['.'] = CharClass::Dot;
+    for (unsigned char ch : {'+', '-', '*', '/', '^'}) {
+        table[ch] = CharClass::Operator;
+    }
+    table['('] = CharClass::OpenScope;
+    table[')'] = CharClass::CloseScope;
+    return table;
+}
+
+inline constexpr std::array<CharClass, 256> kCharClass = MakeCharClassTable();
+
+constexpr CharClass ClassOf(char ch) {
+    return kCharClass[static_cast<unsigned char>(ch)];
+}
+
+constexpr bool IsDigit(char ch) {
+    CharClass cls = ClassOf(ch);
+    return cls == CharClass::Zero || cls == CharClass::Digit;
+}
+
+constexpr bool IsAlpha(char ch) {
+    return ClassOf(ch) == CharClass::Alpha;
+}
+
+constexpr bool IsSpace(char ch) {
+    return ClassOf(ch) == CharClass::Space;
+}
+
+size_t SkipSpaces(std::string_view text, size_t index);
+size_t ScanDigits(std::string_view text, size_t index);
+size_t ScanAlpha(std::string_view text, size_t index);
+size_t ScanNumber(std::string_view text, size_t index);
+bool IsNumberLiteral(std::string_view text);
+bool IsIdentifierWord(std::string_view text);
+
+}
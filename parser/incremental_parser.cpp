@@ -0,0 +1,202 @@
+#include "incremental_parser.h"
+#include "char_class.h"
+#include "parser.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+struct PathEntry {
+    AST::NodePtr node;
+    size_t start;
+};
+
+bool IsWordChar(char ch) {
+    return lexer::IsAlpha(ch) || lexer::IsDigit(ch) || ch == '.';
+}
+
+bool IsGroup(std::string_view text) {
+    if (text.size() < 2 || text.front() != '(' || text.back() != ')') {
+        return false;
+    }
+    size_t depth = 0;
+    for (size_t i = 0; i + 1 < text.size(); ++i) {
+        if (text[i] == '(') {
+            ++depth;
+        } else if (text[i] == ')' && --depth == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EndsInLambda(const AST::Node& node, std::string_view text) {
+    const AST::Node* current = &node;
+    size_t start = 0;
+    while (current->token.type == TokenType::BinaryOperator && current->right) {
+        if (IsGroup(text.substr(start, current->length))) {
+            return false;
+        }
+        start += current->right->offset;
+        current = current->right.get();
+    }
+    return current->token.type == TokenType::Lambda;
+}
+
+bool IsOperand(const AST::Node& node, std::string_view text, bool group_only) {
+    if (group_only) {
+        return IsGroup(text);
+    }
+    if (node.isLeaf() || node.token.type == TokenType::UnaryOperator) {
+        return true;
+    }
+    if (node.token.type == TokenType::BinaryOperator && node.left && node.left->length == 0) {
+        return !EndsInLambda(node, text);
+    }
+    return IsGroup(text);
+}
+
+std::vector<PathEntry> FindEnclosingPath(const AST::NodePtr& root, size_t begin, size_t end) {
+    std::vector<PathEntry> path;
+    AST::NodePtr node = root;
+    size_t start = root->offset;
+    while (true) {
+        path.push_back({node, start});
+        AST::NodePtr next;
+        size_t next_start = 0;
+        for (const AST::NodePtr& child : {node->left, node->right}) {
+            if (!child || child->length == 0) {
+                continue;
+            }
+            if (node->token.type == TokenType::Lambda && child == node->left) {
+                continue;
+            }
+            size_t child_start = start + child->offset;
+            if (child_start <= begin && end <= child_start + child->length) {
+                next = child;
+                next_start = child_start;
+                break;
+            }
+        }
+        if (!next) {
+            return path;
+        }
+        node = std::move(next);
+        start = next_start;
+    }
+}
+
+AST::NodePtr TryParseOperand(std::string_view source, size_t start, size_t end, bool group_only,
+                             const AST& previous) {
+    if (start >= end) {
+        return nullptr;
+    }
+    if (start > 0 && IsWordChar(source[start - 1]) && IsWordChar(source[start])) {
+        return nullptr;
+    }
+    if (end < source.size() && IsWordChar(source[end]) && IsWordChar(source[end - 1])) {
+        return nullptr;
+    }
+    std::string_view text = source.substr(start, end - start);
+    Parser parser(std::make_unique<Tokenizer>(text));
+    ParseResult result = previous.arena() ? parser.tryBuildAST(previous.arena())
+                                          : parser.tryBuildAST();
+    if (!result.ok()) {
+        return nullptr;
+    }
+    AST::NodePtr root = result.value().getRoot();
+    if (!IsOperand(*root, text.substr(root->offset, root->length), group_only)) {
+        return nullptr;
+    }
+    return root;
+}
+
+AST::NodePtr Splice(AST& ast, const std::vector<PathEntry>& path, size_t depth, AST::NodePtr replacement,
+                    size_t delta) {
+    replacement->offset += path[depth].start - path[depth - 1].start;
+    for (size_t i = depth; i-- > 0;) {
+        const AST::Node& ancestor = *path[i].node;
+        AST::NodePtr left = ancestor.left;
+        AST::NodePtr right = ancestor.right;
+        if (left == path[i + 1].node) {
+            left = std::move(replacement);
+            if (right) {
+                AST::NodePtr shifted = ast.makeNode(right->token, right->left, right->right);
+                shifted->offset = right->offset + delta;
+                shifted->length = right->length;
+                right = std::move(shifted);
+            }
+        } else {
+            right = std::move(replacement);
+        }
+        replacement = ast.makeNode(ancestor.token, std::move(left), std::move(right));
+        replacement->offset = ancestor.offset;
+        replacement->length = ancestor.length + delta;
+    }
+    return replacement;
+}
+}
+
+TextEdit IncrementalParser::difference(std::string_view old_source, std::string_view new_source) {
+    size_t prefix = 0;
+    size_t limit = std::min(old_source.size(), new_source.size());
+    while (prefix < limit && old_source[prefix] == new_source[prefix]) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           old_source[old_source.size() - 1 - suffix] == new_source[new_source.size() - 1 - suffix]) {
+        ++suffix;
+    }
+    return {prefix, old_source.size() - prefix - suffix,
+            std::string(new_source.substr(prefix, new_source.size() - prefix - suffix))};
+}
+
+std::string IncrementalParser::applyEdit(std::string_view source, const TextEdit& edit) {
+    if (edit.offset > source.size() || edit.removed > source.size() - edit.offset) {
+        throw std::out_of_range("Edit range is outside the source");
+    }
+    std::string result;
+    result.reserve(source.size() - edit.removed + edit.inserted.size());
+    result.append(source.substr(0, edit.offset));
+    result.append(edit.inserted);
+    result.append(source.substr(edit.offset + edit.removed));
+    return result;
+}
+
+ReparseResult IncrementalParser::reparse(AST previous, std::string_view old_source, const TextEdit& edit) {
+    ReparseResult result;
+    result.source = applyEdit(old_source, edit);
+    size_t delta = edit.inserted.size() - edit.removed;
+
+    AST::NodePtr root = previous.getRoot();
+    bool tree = previous.sharing() == AST::Sharing::Tree;
+    if (tree && root && root->offset + root->length <= old_source.size()) {
+        std::vector<PathEntry> path = FindEnclosingPath(root, edit.offset, edit.offset + edit.removed);
+        for (size_t depth = path.size() - 1; depth > 0; --depth) {
+            size_t start = path[depth].start;
+            size_t end = start + path[depth].node->length + delta;
+            bool group_only = path[depth - 1].node->token.type == TokenType::UnaryOperator;
+            AST::NodePtr replacement = TryParseOperand(result.source, start, end, group_only, previous);
+            if (replacement) {
+                AST::NodePtr spliced = Splice(previous, path, depth, std::move(replacement), delta);
+                result.ast = std::move(previous);
+                result.ast.setRoot(std::move(spliced));
+                result.reparsed_bytes = end - start;
+                return result;
+            }
+        }
+    }
+
+    Parser parser(result.source);
+    if (!tree) {
+        result.ast = parser.buildAST(previous.allocation(), previous.sharing());
+    } else {
+        result.ast = previous.arena() ? parser.buildAST(previous.arena()) : parser.buildAST();
+    }
+    result.reparsed_bytes = result.source.size();
+    result.full_reparse = true;
+    return result;
+}
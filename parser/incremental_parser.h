@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../ast/ast.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+struct TextEdit {
+    size_t offset = 0;
+    size_t removed = 0;
+    std::string inserted;
+};
+
+struct ReparseResult {
+    AST ast;
+    std::string source;
+    size_t reparsed_bytes = 0;
+    bool full_reparse = false;
+};
+
+class IncrementalParser {
+  public:
+    static TextEdit difference(std::string_view old_source, std::string_view new_source);
+    static std::string applyEdit(std::string_view source, const TextEdit& edit);
+    static ReparseResult reparse(AST previous, std::string_view old_source, const TextEdit& edit);
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include "char_class.h"
+#include "tokenizer.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace lexer {
+
+struct Keyword {
+    std::string_view spelling;
+    TokenType type;
+};
+
+inline constexpr std::array<Keyword, 14> kKeywords = {{
+    {"sqrt", TokenType::UnaryOperator},
+    {"abs", TokenType::UnaryOperator},
+    {"exp", TokenType::UnaryOperator},
+    {"ln", TokenType::UnaryOperator},
+    {"floor", TokenType::UnaryOperator},
+    {"ceil", TokenType::UnaryOperator},
+    {"round", TokenType::UnaryOperator},
+    {"trunc", TokenType::UnaryOperator},
+    {"sin", TokenType::UnaryOperator},
+    {"cos", TokenType::UnaryOperator},
+    {"tan", TokenType::UnaryOperator},
+    {"ctan", TokenType::UnaryOperator},
+    {"random", TokenType::UnaryOperator},
+    {"lambda", TokenType::Lambda},
+}};
+
+inline constexpr size_t kKeywordTableSize = 32;
+inline constexpr uint8_t kNoKeyword = 0xFF;
+inline constexpr size_t kMinKeywordLength = 2;
+inline constexpr size_t kMaxKeywordLength = 6;
+
+constexpr size_t KeywordHash(std::string_view word) {
+    return (static_cast<unsigned char>(word[0]) + static_cast<unsigned char>(word[1]) +
+            4 * word.size()) % kKeywordTableSize;
+}
+
+constexpr std::array<uint8_t, kKeywordTableSize> MakeKeywordTable() {
+    std::array<uint8_t, kKeywordTableSize> table{};
+    for (auto& slot : table) {
+        slot = kNoKeyword;
+    }
+    for (size_t i = 0; i < kKeywords.size(); ++i) {
+        table[KeywordHash(kKeywords[i].spelling)] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, kKeywordTableSize> kKeywordTable = MakeKeywordTable();
+
+constexpr bool KeywordHashIsPerfect() {
+    for (size_t i = 0; i < kKeywords.size(); ++i) {
+        std::string_view spelling = kKeywords[i].spelling;
+        if (spelling.size() < kMinKeywordLength || spelling.size() > kMaxKeywordLength) {
+            return false;
+        }
+        if (kKeywordTable[KeywordHash(spelling)] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(KeywordHashIsPerfect(), "keyword hash must be collision-free");
+
+constexpr const Keyword* FindKeyword(std::string_view word) {
+    if (word.size() < kMinKeywordLength || word.size() > kMaxKeywordLength) {
+        return nullptr;
+    }
+    uint8_t slot = kKeywordTable[KeywordHash(word)];
+    if (slot == kNoKeyword || kKeywords[slot].spelling != word) {
+        return nullptr;
+    }
+    return &kKeywords[slot];
+}
+
+constexpr std::array<char, 256> MakeByteSpellings() {
+    std::array<char, 256> bytes{};
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<char>(i);
+    }
+    return bytes;
+}
+
+inline constexpr std::array<char, 256> kByteSpellings = MakeByteSpellings();
+
+constexpr std::string_view ByteSpelling(char ch) {
+    return {&kByteSpellings[static_cast<unsigned char>(ch)], 1};
+}
+
+constexpr TokenType SingleCharTokenType(char ch) {
+    switch (ClassOf(ch)) {
+        case CharClass::Operator:
+            return TokenType::BinaryOperator;
+        case CharClass::OpenScope:
+            return TokenType::OpenScope;
+        case CharClass::CloseScope:
+            return TokenType::CloseScope;
+        case CharClass::Dot:
+            return TokenType::Dot;
+        default:
+            return ch == '#' ? TokenType::EndOfFile : TokenType::Error;
+    }
+}
+
+static_assert(FindKeyword("lambda")->type == TokenType::Lambda);
+static_assert(FindKeyword("ctan")->spelling == "ctan");
+static_assert(!FindKeyword("cta"));
+static_assert(SingleCharTokenType('^') == TokenType::BinaryOperator);
+
+}
@@ -0,0 +1,89 @@
+#include "parse_result.h"
+#include "parser_exceptions.h"
+#include <new>
+#include <utility>
+
+namespace {
+std::string FoundText(const ParseError& error, std::string_view text) {
+    if (error.found == TokenType::EndOfFile) {
+        return "#";
+    }
+    return std::string(text);
+}
+
+template <typename Handler>
+auto Dispatch(const ParseError& error, std::string_view text, Handler&& handler) {
+    switch (error.code) {
+        case ParseErrorCode::UnrecognizedToken:
+            return handler(SyntaxError("Unrecognized token: " + FoundText(error, text)));
+        case ParseErrorCode::ExpectedToken:
+            return handler(UnexpectedTokenError(error.expected, FoundText(error, text)));
+        case ParseErrorCode::UnexpectedToken:
+            return handler(SyntaxError("Unexpected token: " + FoundText(error, text)));
+        case ParseErrorCode::UnprocessedTokens:
+            return handler(UnprocessedTokensError(FoundText(error, text)));
+        case ParseErrorCode::InputError:
+            return handler(ParserException("Input source failed"));
+        case ParseErrorCode::OutOfMemory:
+            return handler(ParserException("Out of memory"));
+        default:
+            return handler(ParserException("No error"));
+    }
+}
+}
+
+std::string_view ParseError::span(std::string_view source) const {
+    if (offset > source.size()) {
+        return {};
+    }
+    return source.substr(offset, length);
+}
+
+std::string ParseError::message(std::string_view source) const {
+    return Dispatch(*this, span(source),
+                    [](const ParserException& error) { return std::string(error.what()); });
+}
+
+void ParseError::raise(std::string_view source) const {
+    raiseFound(span(source));
+}
+
+void ParseError::raiseFound(std::string_view found_text) const {
+    if (code == ParseErrorCode::OutOfMemory) {
+        throw std::bad_alloc();
+    }
+    Dispatch(*this, found_text, [](const auto& error) { throw error; });
+    throw ParserException("No error");
+}
+
+ParseResult::ParseResult(AST ast) noexcept : ast_(std::move(ast)) {}
+
+ParseResult::ParseResult(const ParseError& error) noexcept : error_(error) {}
+
+ParseResult::ParseResult(const ParseError& error, std::string_view found) : error_(error), found_(found) {}
+
+bool ParseResult::ok() const noexcept {
+    return error_.code == ParseErrorCode::None;
+}
+
+ParseResult::operator bool() const noexcept {
+    return ok();
+}
+
+AST& ParseResult::value() {
+    if (!ok()) {
+        error_.raiseFound(found_);
+    }
+    return ast_;
+}
+
+const AST& ParseResult::value() const {
+    if (!ok()) {
+        error_.raiseFound(found_);
+    }
+    return ast_;
+}
+
+const ParseError& ParseResult::error() const noexcept {
+    return error_;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../ast/ast.h"
+#include "tokenizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum class ParseErrorCode : uint8_t {
+    None,
+    UnrecognizedToken,
+    ExpectedToken,
+    UnexpectedToken,
+    UnprocessedTokens,
+    InputError,
+    OutOfMemory,
+};
+
+struct ParseError {
+    ParseErrorCode code = ParseErrorCode::None;
+    size_t offset = 0;
+    size_t length = 0;
+    TokenType found = TokenType::EndOfFile;
+    const char* expected = "";
+
+    std::string_view span(std::string_view source) const;
+    std::string message(std::string_view source) const;
+    [[noreturn]] void raise(std::string_view source) const;
+    [[noreturn]] void raiseFound(std::string_view found_text) const;
+};
+
+class ParseResult {
+  public:
+    ParseResult() noexcept = default;
+    ParseResult(AST ast) noexcept;
+    ParseResult(const ParseError& error) noexcept;
+    ParseResult(const ParseError& error, std::string_view found);
+
+    bool ok() const noexcept;
+    explicit operator bool() const noexcept;
+    AST& value();
+    const AST& value() const;
+    const ParseError& error() const noexcept;
+
+  private:
+    AST ast_;
+    ParseError error_;
+    std::string found_;
+};
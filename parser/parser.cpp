@@ -1,54 +1,162 @@
 #include "parser.h"
-#include <algorithm>
+#include "stream_tokenizer.h"
+#include <array>
+#include <new>
 #include <utility>
 
-Parser::Parser(const std::string& input) {
-    Tokenizer tokenizer(input);
-    tokens_ = tokenizer.tokenizeAll();
-    if (tokens_.empty()) {
-        throw EmptyInputError();
+namespace {
+struct BindingPower {
+    uint8_t left = 0;
+    uint8_t right = 0;
+};
+
+constexpr std::array<BindingPower, 256> MakeBindingPowers() {
+    std::array<BindingPower, 256> powers{};
+    powers['+'] = {10, 11};
+    powers['-'] = {10, 11};
+    powers['*'] = {20, 21};
+    powers['/'] = {20, 21};
+    powers['^'] = {30, 30};
+    return powers;
+}
+
+constexpr std::array<BindingPower, 256> kBindingPowers = MakeBindingPowers();
+
+BindingPower BindingPowerOf(const TokenView& token) {
+    if (token.type != TokenType::BinaryOperator || token.value.size() != 1) {
+        return {};
     }
-    if (tokens_.back().type != TokenType::EndOfFile) {
-        tokens_.push_back(Token{TokenType::EndOfFile, "#"});
+    return kBindingPowers[static_cast<unsigned char>(token.value[0])];
+}
+
+bool IsPrefixOperator(const TokenView& token) {
+    return token.value == "+" || token.value == "-";
+}
+
+size_t SpanEnd(const AST::Node& node) {
+    return node.offset + node.length;
+}
+
+}
+
+Parser::Parser(const std::string& input)
+    : source_(input), tokens_(std::make_unique<Tokenizer>(source_)) {}
+
+Parser::Parser(std::istream& input)
+    : tokens_(std::make_unique<StreamTokenizer>(input)) {}
+
+Parser::Parser(std::unique_ptr<TokenSource> tokens) : tokens_(std::move(tokens)) {
+    if (!tokens_) {
+        throw EmptyInputError();
     }
 }
 
-AST Parser::buildAST() {
-    current_index_ = 0;
-    AST::NodePtr root = parseExpression();
+AST Parser::buildAST(AST::Allocation allocation, AST::Sharing sharing) {
+    return build(AST(allocation, sharing));
+}
 
-    if (!isAtEnd()) {
-        throw UnprocessedTokensError(peek().value);
+AST Parser::buildAST(std::shared_ptr<NodeArena> arena) {
+    return build(AST(std::move(arena)));
+}
+
+ParseResult Parser::tryBuildAST(AST::Allocation allocation) noexcept {
+    try {
+        return tryBuild(AST(allocation));
+    } catch (const std::bad_alloc&) {
+        return ParseError{ParseErrorCode::OutOfMemory};
     }
+}
+
+ParseResult Parser::tryBuildAST(std::shared_ptr<NodeArena> arena) noexcept {
+    return tryBuild(AST(std::move(arena)));
+}
 
-    AST ast;
-    ast.setRoot(root);
+AST Parser::build(AST ast) {
+    if (!parse(ast)) {
+        error_.raiseFound(current_.value);
+    }
     return ast;
 }
 
-const Token& Parser::peek() const {
-    if (current_index_ < tokens_.size()) {
-        return tokens_[current_index_];
+ParseResult Parser::tryBuild(AST ast) noexcept {
+    try {
+        if (!parse(ast)) {
+            return ParseResult(error_, current_.value);
+        }
+        return ast;
+    } catch (const std::bad_alloc&) {
+        error_ = ParseError{ParseErrorCode::OutOfMemory, current_offset_};
+    } catch (...) {
+        error_ = ParseError{ParseErrorCode::InputError, current_offset_};
+    }
+    frames_.clear();
+    target_ = nullptr;
+    return error_;
+}
+
+bool Parser::parse(AST& ast) {
+    target_ = &ast;
+    spans_ = ast.sharing() == AST::Sharing::Tree;
+    error_ = ParseError{};
+    tokens_->reset();
+    previous_ = TokenView{TokenType::EndOfFile, "#"};
+    current_ = pull();
+    AST::NodePtr root = failed() ? nullptr : parseExpression();
+
+    if (!failed() && !isAtEnd()) {
+        fail(ParseErrorCode::UnprocessedTokens);
+    }
+
+    target_ = nullptr;
+    if (failed()) {
+        frames_.clear();
+        return false;
+    }
+    ast.setRoot(std::move(root));
+    return true;
+}
+
+bool Parser::failed() const {
+    return error_.code != ParseErrorCode::None;
+}
+
+void Parser::fail(ParseErrorCode code, const char* expected) {
+    if (failed()) {
+        return;
     }
-    static Token eofToken{TokenType::EndOfFile, "#"};
-    return eofToken;
+    size_t length = current_.type == TokenType::EndOfFile ? 0 : current_.value.size();
+    error_ = ParseError{code, current_offset_, length, current_.type, expected};
 }
 
-const Token& Parser::previous() const {
-    if (current_index_ == 0) {
-        static Token dummy{TokenType::EndOfFile, "#"};
-        return dummy;
+TokenView Parser::pull() {
+    TokenView token = tokens_->nextTokenView();
+    size_t length = token.type == TokenType::EndOfFile ? 0 : token.value.size();
+    current_offset_ = tokens_->position() - length;
+    if (token.type == TokenType::Error) {
+        current_ = token;
+        fail(ParseErrorCode::UnrecognizedToken);
+        return {TokenType::EndOfFile, token.value};
     }
-    return tokens_[current_index_ - 1];
+    return token;
+}
+
+const TokenView& Parser::peek() const {
+    return current_;
+}
+
+const TokenView& Parser::previous() const {
+    return previous_;
 }
 
 bool Parser::isAtEnd() const {
     return peek().type == TokenType::EndOfFile;
 }
 
-const Token& Parser::advance() {
+const TokenView& Parser::advance() {
     if (!isAtEnd()) {
-        ++current_index_;
+        previous_ = current_;
+        previous_offset_ = current_offset_;
+        current_ = pull();
     }
     return previous();
 }
@@ -68,109 +176,183 @@ bool Parser::match(TokenType type) {
     return false;
 }
 
-bool Parser::matchBinaryOperator(const std::vector<std::string>& operators) {
-    if (!check(TokenType::BinaryOperator)) {
-        return false;
-    }
-    const std::string& value = peek().value;
-    if (std::find(operators.begin(), operators.end(), value) == operators.end()) {
-        return false;
-    }
-    advance();
-    return true;
-}
-
-Token Parser::consume(TokenType type, const std::string& message) {
+TokenView Parser::consume(TokenType type, const char* expected) {
     if (check(type)) {
         return advance();
     }
-    throw UnexpectedTokenError(message, peek().value);
+    fail(ParseErrorCode::ExpectedToken, expected);
+    return peek();
 }
 
 AST::NodePtr Parser::parseExpression() {
-    return parseAddition();
-}
+    frames_.clear();
+    frames_.push_back({Frame::Kind::Expression, 0});
+    AST::NodePtr value = parseOperand();
+
+    while (!failed()) {
+        BindingPower power = BindingPowerOf(peek());
+        if (power.left != 0 && power.left >= frames_.back().min_power) {
+            TokenView op = advance();
+            frames_.push_back({Frame::Kind::Binary, 0, op, std::move(value)});
+            frames_.push_back({Frame::Kind::Expression, power.right});
+            value = parseOperand();
+            continue;
+        }
 
-AST::NodePtr Parser::parseAddition() {
-    AST::NodePtr node = parseMultiplication();
-    while (matchBinaryOperator({"+", "-"})) {
-        Token op = previous();
-        AST::NodePtr right = parseMultiplication();
-        node = makeBinaryNode(std::move(op), std::move(node), std::move(right));
+        frames_.pop_back();
+        if (frames_.empty()) {
+            return value;
+        }
+
+        Frame& owner = frames_.back();
+        switch (owner.kind) {
+            case Frame::Kind::Binary:
+                value = makeBinaryNode(owner.op, std::move(owner.operand), std::move(value));
+                frames_.pop_back();
+                break;
+            case Frame::Kind::Call: {
+                consume(TokenType::CloseScope, "')' after unary operator");
+                if (failed()) {
+                    return nullptr;
+                }
+                TokenView op = owner.op;
+                size_t start = owner.start;
+                size_t end = previous_offset_ + 1;
+                widenSpan(*value, owner.open, end);
+                frames_.pop_back();
+                AST::NodePtr call_node = makeUnaryNode(op, std::move(value));
+                setSpan(*call_node, start, end);
+                value = completeOperand(std::move(call_node));
+                break;
+            }
+            case Frame::Kind::Group:
+                consume(TokenType::CloseScope, "closing parenthesis");
+                if (failed()) {
+                    return nullptr;
+                }
+                widenSpan(*value, owner.start, previous_offset_ + 1);
+                frames_.pop_back();
+                value = completeOperand(std::move(value));
+                break;
+            case Frame::Kind::Lambda: {
+                size_t end = SpanEnd(*value);
+                AST::NodePtr lambda_node =
+                    target_->makeNode(owner.op, std::move(owner.operand), std::move(value));
+                setSpan(*lambda_node, owner.start, end);
+                frames_.pop_back();
+                value = completeOperand(std::move(lambda_node));
+                break;
+            }
+            default:
+                fail(ParseErrorCode::UnexpectedToken);
+                return nullptr;
+        }
     }
-    return node;
+    return nullptr;
 }
 
-AST::NodePtr Parser::parseMultiplication() {
-    AST::NodePtr node = parseExponentiation();
-    while (matchBinaryOperator({"*", "/"})) {
-        Token op = previous();
-        AST::NodePtr right = parseExponentiation();
-        node = makeBinaryNode(std::move(op), std::move(node), std::move(right));
+AST::NodePtr Parser::parseOperand() {
+    while (!failed()) {
+        if (check(TokenType::UnaryOperator)) {
+            TokenView op = advance();
+            size_t start = previous_offset_;
+            consume(TokenType::OpenScope, "'(' after unary operator");
+            if (failed()) {
+                return nullptr;
+            }
+            frames_.push_back({Frame::Kind::Call, 0, op, nullptr, start, previous_offset_});
+            frames_.push_back({Frame::Kind::Expression, 0});
+            continue;
+        }
+        if (check(TokenType::BinaryOperator) && IsPrefixOperator(peek())) {
+            TokenView op = advance();
+            frames_.push_back({Frame::Kind::Negate, 0, op, nullptr, previous_offset_});
+            continue;
+        }
+        if (match(TokenType::Lambda)) {
+            TokenView lambda_token = previous();
+            size_t start = previous_offset_;
+            TokenView parameter = consume(TokenType::ID, "identifier after lambda");
+            if (failed()) {
+                return nullptr;
+            }
+            AST::NodePtr parameter_node = makeLeaf(parameter, previous_offset_, parameter.value.size());
+            consume(TokenType::Dot, "'.' after lambda parameter");
+            if (failed()) {
+                return nullptr;
+            }
+            frames_.push_back({Frame::Kind::Lambda, 0, lambda_token, std::move(parameter_node), start});
+            frames_.push_back({Frame::Kind::Expression, 0});
+            continue;
+        }
+        if (match(TokenType::Number) || match(TokenType::ID)) {
+            return completeOperand(makeLeaf(previous(), previous_offset_, previous().value.size()));
+        }
+        if (match(TokenType::OpenScope)) {
+            frames_.push_back({Frame::Kind::Group, 0, previous(), nullptr, previous_offset_});
+            frames_.push_back({Frame::Kind::Expression, 0});
+            continue;
+        }
+        fail(ParseErrorCode::UnexpectedToken);
     }
-    return node;
+    return nullptr;
 }
 
-AST::NodePtr Parser::parseExponentiation() {
-    AST::NodePtr node = parseUnary();
-    if (matchBinaryOperator({"^"})) {
-        Token op = previous();
-        AST::NodePtr right = parseExponentiation();
-        node = makeBinaryNode(std::move(op), std::move(node), std::move(right));
+AST::NodePtr Parser::completeOperand(AST::NodePtr operand) {
+    while (!frames_.empty() && frames_.back().kind == Frame::Kind::Negate) {
+        TokenView op = frames_.back().op;
+        size_t start = frames_.back().start;
+        frames_.pop_back();
+        AST::NodePtr zero_node = makeLeaf(TokenView{TokenType::Number, "0"}, start, 0);
+        operand = makeBinaryNode(op, std::move(zero_node), std::move(operand));
     }
-    return node;
+    return operand;
 }
 
-AST::NodePtr Parser::parseUnary() {
-    if (check(TokenType::UnaryOperator)) {
-        Token op = advance();
-        consume(TokenType::OpenScope, "'(' after unary operator");
-        AST::NodePtr operand = parseExpression();
-        consume(TokenType::CloseScope, "')' after unary operator");
-        return makeUnaryNode(std::move(op), std::move(operand));
-    }
-    if (check(TokenType::BinaryOperator) && (peek().value == "-" || peek().value == "+")) {
-        Token op = advance();
-        AST::NodePtr operand = parseUnary();
-        AST::NodePtr zero_node = AST::createLeaf(Token{TokenType::Number, "0"});
-        return makeBinaryNode(std::move(op), std::move(zero_node), std::move(operand));
-    }
-    if (match(TokenType::Lambda)) {
-        Token lambda_token = previous();
-        Token identifier = consume(TokenType::ID, "identifier after lambda");
-        consume(TokenType::Dot, "'.' after lambda parameter");
-        AST::NodePtr body = parseExpression();
-        AST::NodePtr parameter_node = AST::createLeaf(std::move(identifier));
-        AST::NodePtr lambda_node = AST::createNode(std::move(lambda_token), std::move(parameter_node), std::move(body));
-        return lambda_node;
-    }
-    return parsePrimary();
+AST::NodePtr Parser::makeBinaryNode(const TokenView& op, AST::NodePtr left, AST::NodePtr right) {
+    size_t start = left->offset;
+    size_t end = SpanEnd(*right);
+    AST::NodePtr node = target_->makeNode(op, std::move(left), std::move(right));
+    setSpan(*node, start, end);
+    return node;
 }
 
-AST::NodePtr Parser::parsePrimary() {
-    if (match(TokenType::Number) || match(TokenType::ID)) {
-        return AST::createLeaf(previous());
-    }
+AST::NodePtr Parser::makeUnaryNode(const TokenView& op, AST::NodePtr child) {
+    return target_->makeNode(op, std::move(child), nullptr);
+}
 
-    if (match(TokenType::OpenScope)) {
-        AST::NodePtr expr = parseExpression();
-        consume(TokenType::CloseScope, "closing parenthesis");
-        return expr;
+AST::NodePtr Parser::makeLeaf(const TokenView& token, size_t offset, size_t length) {
+    AST::NodePtr leaf = target_->makeLeaf(token);
+    if (spans_) {
+        leaf->offset = offset;
+        leaf->length = length;
     }
-
-    throw SyntaxError("Unexpected token: " + peek().value);
+    return leaf;
 }
 
-AST::NodePtr Parser::makeBinaryNode(Token op, AST::NodePtr left, AST::NodePtr right) {
-    if (!left || !right) {
-        throw ParserException("Binary operator missing operand: " + op.value);
+void Parser::setSpan(AST::Node& node, size_t start, size_t end) const {
+    if (!spans_) {
+        return;
+    }
+    for (AST::Node* child : {node.left.get(), node.right.get()}) {
+        if (child) {
+            child->offset -= start;
+        }
     }
-    return AST::createNode(std::move(op), std::move(left), std::move(right));
+    node.offset = start;
+    node.length = end - start;
 }
 
-AST::NodePtr Parser::makeUnaryNode(Token op, AST::NodePtr child) {
-    if (!child) {
-        throw ParserException("Unary operator missing operand: " + op.value);
+void Parser::widenSpan(AST::Node& node, size_t start, size_t end) const {
+    if (!spans_) {
+        return;
     }
-    return AST::createNode(std::move(op), std::move(child), nullptr);
-}
\ No newline at end of file
+    size_t shift = node.offset - start;
+    for (AST::Node* child : {node.left.get(), node.right.get()}) {
+        if (child) {
+            child->offset += shift;
+        }
+    }
+    node.offset = start;
+    node.length = end - start;
+}
@@ -2,35 +2,78 @@
 
 #include "../ast/ast.h"
 #include "tokenizer.h"
+#include "parse_result.h"
 #include "parser_exceptions.h"
+#include <cstdint>
+#include <istream>
+#include <memory>
 #include <string>
 #include <vector>
 
 class Parser {
   public:
     explicit Parser(const std::string& input);
-    AST buildAST();
+    explicit Parser(std::istream& input);
+    explicit Parser(std::unique_ptr<TokenSource> tokens);
+    Parser(const Parser&) = delete;
+    Parser& operator=(const Parser&) = delete;
+    AST buildAST(AST::Allocation allocation = AST::Allocation::Heap,
+                 AST::Sharing sharing = AST::Sharing::Tree);
+    AST buildAST(std::shared_ptr<NodeArena> arena);
+    ParseResult tryBuildAST(AST::Allocation allocation = AST::Allocation::Heap) noexcept;
+    ParseResult tryBuildAST(std::shared_ptr<NodeArena> arena) noexcept;
 
   private:
-    std::vector<Token> tokens_;
-    size_t current_index_ = 0;
+    struct Frame {
+        enum class Kind : uint8_t {
+            Expression,
+            Binary,
+            Negate,
+            Call,
+            Group,
+            Lambda,
+        };
 
-    const Token& peek() const;
-    const Token& previous() const;
+        Kind kind;
+        uint8_t min_power = 0;
+        TokenView op{TokenType::EndOfFile, "#"};
+        AST::NodePtr operand{};
+        size_t start = 0;
+        size_t open = 0;
+    };
+
+    std::string source_;
+    std::unique_ptr<TokenSource> tokens_;
+    AST* target_ = nullptr;
+    TokenView current_{TokenType::EndOfFile, "#"};
+    TokenView previous_{TokenType::EndOfFile, "#"};
+    size_t current_offset_ = 0;
+    size_t previous_offset_ = 0;
+    bool spans_ = true;
+    ParseError error_;
+    std::vector<Frame> frames_;
+
+    AST build(AST ast);
+    ParseResult tryBuild(AST ast) noexcept;
+    bool parse(AST& ast);
+    bool failed() const;
+    void fail(ParseErrorCode code, const char* expected = "");
+    TokenView pull();
+    const TokenView& peek() const;
+    const TokenView& previous() const;
     bool isAtEnd() const;
-    const Token& advance();
+    const TokenView& advance();
     bool check(TokenType type) const;
     bool match(TokenType type);
-    bool matchBinaryOperator(const std::vector<std::string>& operators);
-    Token consume(TokenType type, const std::string& message);
+    TokenView consume(TokenType type, const char* expected);
 
     AST::NodePtr parseExpression();
-    AST::NodePtr parseAddition();
-    AST::NodePtr parseMultiplication();
-    AST::NodePtr parseExponentiation();
-    AST::NodePtr parseUnary();
-    AST::NodePtr parsePrimary();
-
-    static AST::NodePtr makeBinaryNode(Token op, AST::NodePtr left, AST::NodePtr right);
-    static AST::NodePtr makeUnaryNode(Token op, AST::NodePtr child);
+    AST::NodePtr parseOperand();
+    AST::NodePtr completeOperand(AST::NodePtr operand);
+
+    AST::NodePtr makeBinaryNode(const TokenView& op, AST::NodePtr left, AST::NodePtr right);
+    AST::NodePtr makeUnaryNode(const TokenView& op, AST::NodePtr child);
+    AST::NodePtr makeLeaf(const TokenView& token, size_t offset, size_t length);
+    void setSpan(AST::Node& node, size_t start, size_t end) const;
+    void widenSpan(AST::Node& node, size_t start, size_t end) const;
 };
\ No newline at end of file
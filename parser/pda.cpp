@@ -1,174 +1,342 @@
 #include "pda.h"
 #include "parser_exceptions.h"
+#include <array>
+#include <string>
+#include <utility>
 
-PDA::PDA(const std::vector<Token>& input_tokens) : tokens_(input_tokens) {
-    InitGrammar();
+namespace {
+enum class TokenClass : uint8_t {
+    Number,
+    ID,
+    Lambda,
+    Dot,
+    Plus,
+    Minus,
+    Star,
+    Slash,
+    Caret,
+    Function,
+    Open,
+    Close,
+    End,
+    Invalid,
+};
+
+enum class Action : uint8_t {
+    Binary,
+    Negate,
+    Call,
+    Lambda,
+};
+
+enum class Production : uint8_t {
+    Expression,
+    AddPlus,
+    AddMinus,
+    AddEnd,
+    Term,
+    MultiplyStar,
+    MultiplySlash,
+    MultiplyEnd,
+    Power,
+    PowerCaret,
+    PowerEnd,
+    NegatePlus,
+    NegateMinus,
+    UnaryPrimary,
+    Number,
+    Identifier,
+    Group,
+    Call,
+    Lambda,
+};
+
+constexpr size_t kTokenClassCount = static_cast<size_t>(TokenClass::Invalid) + 1;
+constexpr size_t kNonTerminalCount = static_cast<size_t>(NonTerminal::Primary) + 1;
+constexpr size_t kProductionCount = static_cast<size_t>(Production::Lambda) + 1;
+constexpr size_t kMaxRuleLength = 5;
+constexpr uint8_t kNonTerminalBase = 16;
+constexpr uint8_t kActionBase = 32;
+constexpr uint8_t kNoRule = 0xFF;
+
+constexpr uint8_t Symbol(TokenClass terminal) {
+    return static_cast<uint8_t>(terminal);
 }
 
-void PDA::InitGrammar() {
-    grammar_[NonTerminal::E] = {
-        {NonTerminal::T, NonTerminal::E_}
-    };
+constexpr uint8_t Symbol(NonTerminal non_terminal) {
+    return kNonTerminalBase + static_cast<uint8_t>(non_terminal);
+}
 
-    grammar_[NonTerminal::E_] = {
-        {TokenType::BinaryOperator, NonTerminal::T, NonTerminal::E_},
-        {}
-    };
+constexpr uint8_t Symbol(Action action) {
+    return kActionBase + static_cast<uint8_t>(action);
+}
 
-    grammar_[NonTerminal::T] = {
-        {NonTerminal::F, NonTerminal::T_}
-    };
+struct Rule {
+    uint8_t length;
+    std::array<uint8_t, kMaxRuleLength> symbols;
+};
 
-    grammar_[NonTerminal::T_] = {
-        {TokenType::BinaryOperator, NonTerminal::F, NonTerminal::T_},
-        {}
-    };
+constexpr std::array<Rule, kProductionCount> kRules = {{
+    {2, {Symbol(NonTerminal::T), Symbol(NonTerminal::E_)}},
+    {4, {Symbol(TokenClass::Plus), Symbol(NonTerminal::T), Symbol(Action::Binary), Symbol(NonTerminal::E_)}},
+    {4, {Symbol(TokenClass::Minus), Symbol(NonTerminal::T), Symbol(Action::Binary), Symbol(NonTerminal::E_)}},
+    {0, {}},
+    {2, {Symbol(NonTerminal::P), Symbol(NonTerminal::T_)}},
+    {4, {Symbol(TokenClass::Star), Symbol(NonTerminal::P), Symbol(Action::Binary), Symbol(NonTerminal::T_)}},
+    {4, {Symbol(TokenClass::Slash), Symbol(NonTerminal::P), Symbol(Action::Binary), Symbol(NonTerminal::T_)}},
+    {0, {}},
+    {2, {Symbol(NonTerminal::U), Symbol(NonTerminal::P_)}},
+    {3, {Symbol(TokenClass::Caret), Symbol(NonTerminal::P), Symbol(Action::Binary)}},
+    {0, {}},
+    {3, {Symbol(TokenClass::Plus), Symbol(NonTerminal::U), Symbol(Action::Negate)}},
+    {3, {Symbol(TokenClass::Minus), Symbol(NonTerminal::U), Symbol(Action::Negate)}},
+    {1, {Symbol(NonTerminal::Primary)}},
+    {1, {Symbol(TokenClass::Number)}},
+    {1, {Symbol(TokenClass::ID)}},
+    {3, {Symbol(TokenClass::Open), Symbol(NonTerminal::E), Symbol(TokenClass::Close)}},
+    {5, {Symbol(TokenClass::Function), Symbol(TokenClass::Open), Symbol(NonTerminal::E),
+         Symbol(TokenClass::Close), Symbol(Action::Call)}},
+    {5, {Symbol(TokenClass::Lambda), Symbol(TokenClass::ID), Symbol(TokenClass::Dot),
+         Symbol(NonTerminal::E), Symbol(Action::Lambda)}},
+}};
 
-    grammar_[NonTerminal::F] = {
-        {TokenType::Number},
-        {TokenType::ID},
-        {TokenType::OpenScope, NonTerminal::E, TokenType::CloseScope},
-        {TokenType::UnaryOperator, NonTerminal::F},
-        {TokenType::Lambda, TokenType::Dot, TokenType::ID}
-    };
+using ParseTable = std::array<std::array<uint8_t, kTokenClassCount>, kNonTerminalCount>;
+
+constexpr void SetRule(ParseTable& table, NonTerminal non_terminal, TokenClass lookahead,
+                       Production production) {
+    table[static_cast<size_t>(non_terminal)][static_cast<size_t>(lookahead)] =
+        static_cast<uint8_t>(production);
 }
 
-bool PDA::IsTerminal(const StackSymbol& symbol) const {
-    return std::holds_alternative<TokenType>(symbol);
+constexpr ParseTable MakeParseTable() {
+    ParseTable table{};
+    for (auto& row : table) {
+        for (auto& cell : row) {
+            cell = kNoRule;
+        }
+    }
+
+    constexpr TokenClass kOperandStarts[] = {
+        TokenClass::Number, TokenClass::ID, TokenClass::Open, TokenClass::Function,
+        TokenClass::Lambda, TokenClass::Plus, TokenClass::Minus,
+    };
+    for (TokenClass lookahead : kOperandStarts) {
+        SetRule(table, NonTerminal::E, lookahead, Production::Expression);
+        SetRule(table, NonTerminal::T, lookahead, Production::Term);
+        SetRule(table, NonTerminal::P, lookahead, Production::Power);
+        SetRule(table, NonTerminal::U, lookahead, Production::UnaryPrimary);
+    }
+    SetRule(table, NonTerminal::U, TokenClass::Plus, Production::NegatePlus);
+    SetRule(table, NonTerminal::U, TokenClass::Minus, Production::NegateMinus);
+
+    SetRule(table, NonTerminal::Primary, TokenClass::Number, Production::Number);
+    SetRule(table, NonTerminal::Primary, TokenClass::ID, Production::Identifier);
+    SetRule(table, NonTerminal::Primary, TokenClass::Open, Production::Group);
+    SetRule(table, NonTerminal::Primary, TokenClass::Function, Production::Call);
+    SetRule(table, NonTerminal::Primary, TokenClass::Lambda, Production::Lambda);
+
+    for (size_t lookahead = 0; lookahead < kTokenClassCount; ++lookahead) {
+        SetRule(table, NonTerminal::E_, static_cast<TokenClass>(lookahead), Production::AddEnd);
+        SetRule(table, NonTerminal::T_, static_cast<TokenClass>(lookahead), Production::MultiplyEnd);
+        SetRule(table, NonTerminal::P_, static_cast<TokenClass>(lookahead), Production::PowerEnd);
+    }
+    SetRule(table, NonTerminal::E_, TokenClass::Plus, Production::AddPlus);
+    SetRule(table, NonTerminal::E_, TokenClass::Minus, Production::AddMinus);
+    SetRule(table, NonTerminal::T_, TokenClass::Star, Production::MultiplyStar);
+    SetRule(table, NonTerminal::T_, TokenClass::Slash, Production::MultiplySlash);
+    SetRule(table, NonTerminal::P_, TokenClass::Caret, Production::PowerCaret);
+    return table;
 }
 
-bool PDA::IsNonTerminal(const StackSymbol& symbol) const {
-    return std::holds_alternative<NonTerminal>(symbol);
+constexpr ParseTable kParseTable = MakeParseTable();
+
+constexpr std::array<TokenClass, 256> MakeOperatorClasses() {
+    std::array<TokenClass, 256> classes{};
+    for (auto& cls : classes) {
+        cls = TokenClass::Invalid;
+    }
+    classes['+'] = TokenClass::Plus;
+    classes['-'] = TokenClass::Minus;
+    classes['*'] = TokenClass::Star;
+    classes['/'] = TokenClass::Slash;
+    classes['^'] = TokenClass::Caret;
+    return classes;
 }
 
-std::vector<StackSymbol> PDA::SelectRule(NonTerminal non_terminal, TokenType lookahead) {
-    auto& rules = grammar_[non_terminal];
+constexpr std::array<TokenClass, 256> kOperatorClasses = MakeOperatorClasses();
 
-    switch (non_terminal) {
-        case NonTerminal::E:
-            return rules[0];
+constexpr std::array<const char*, kTokenClassCount> kTerminalNames = {
+    "number", "identifier", "lambda", "'.'", "'+'", "'-'", "'*'",
+    "'/'", "'^'", "unary operator", "'('", "')'", "end of input", "valid token",
+};
 
-        case NonTerminal::E_:
-            if (lookahead == TokenType::BinaryOperator) {
-                if (current_index_ < tokens_.size()) {
-                    const std::string& op = tokens_[current_index_].value;
-                    if (op == "+" || op == "-") {
-                        return rules[0];
-                    }
-                }
-            }
-            return rules[1];
-
-        case NonTerminal::T:
-            return rules[0];
-
-        case NonTerminal::T_:
-            if (lookahead == TokenType::BinaryOperator) {
-                if (current_index_ < tokens_.size()) {
-                    const std::string& op = tokens_[current_index_].value;
-                    if (op == "*" || op == "/" || op == "^") {
-                        return rules[0];
-                    }
-                }
-            }
-            return rules[1];
-
-        case NonTerminal::F:
-            if (lookahead == TokenType::Number) {
-                return rules[0];
-            } else if (lookahead == TokenType::ID) {
-                return rules[1];
-            } else if (lookahead == TokenType::OpenScope) {
-                return rules[2];
-            } else if (lookahead == TokenType::UnaryOperator) {
-                if (current_index_ < tokens_.size()) {
-                    const std::string& op = tokens_[current_index_].value;
-                    if (op == "+" || op == "-" || op == "*" || op == "/" || op == "^") {
-                        throw SyntaxError("Unexpected binary operator '" + op + "' in operand position");
-                    }
-                }
-                return rules[3];
-            } else if (lookahead == TokenType::Lambda) {
-                return rules[4];
-            } else if (lookahead == TokenType::BinaryOperator) {
-                if (current_index_ < tokens_.size()) {
-                    throw SyntaxError("Unexpected operator '" + tokens_[current_index_].value +
-                                      "' where operand expected (number, variable or expression)");
-                }
-                return {};
-            }
-            break;
+TokenClass ClassOf(const TokenView& token) {
+    switch (token.type) {
+        case TokenType::Number:
+            return TokenClass::Number;
+        case TokenType::ID:
+            return TokenClass::ID;
+        case TokenType::Lambda:
+            return TokenClass::Lambda;
+        case TokenType::Dot:
+            return TokenClass::Dot;
+        case TokenType::BinaryOperator:
+            return token.value.size() == 1
+                       ? kOperatorClasses[static_cast<unsigned char>(token.value[0])]
+                       : TokenClass::Invalid;
+        case TokenType::UnaryOperator:
+            return TokenClass::Function;
+        case TokenType::OpenScope:
+            return TokenClass::Open;
+        case TokenType::CloseScope:
+            return TokenClass::Close;
+        case TokenType::EndOfFile:
+            return TokenClass::End;
+        default:
+            return TokenClass::Invalid;
     }
+}
 
-    return {};
+AST::NodePtr PopValue(std::vector<AST::NodePtr>& values) {
+    AST::NodePtr value = std::move(values.back());
+    values.pop_back();
+    return value;
+}
+
+TokenView PopOperator(std::vector<TokenView>& operators) {
+    TokenView op = operators.back();
+    operators.pop_back();
+    return op;
+}
 }
 
-bool PDA::Match(TokenType expected) {
-    if (current_index_ >= tokens_.size()) {
-        throw UnexpectedEOFError();
+PDA::PDA(const std::vector<Token>& input_tokens) : owned_tokens_(input_tokens) {
+    tokens_.reserve(owned_tokens_.size());
+    for (const Token& token : owned_tokens_) {
+        tokens_.push_back(TokenView{token.type, token.value, token.symbol});
     }
+}
+
+PDA::PDA(std::vector<TokenView> input_tokens) : tokens_(std::move(input_tokens)) {}
 
-    TokenType current = tokens_[current_index_].type;
+const TokenView& PDA::CurrentToken() const {
+    static const TokenView end_of_input{TokenType::EndOfFile, "#"};
+    return current_index_ < tokens_.size() ? tokens_[current_index_] : end_of_input;
+}
 
-    if (expected == current) {
-        ++current_index_;
-        return true;
+void PDA::Shift(AST& ast) {
+    const TokenView& token = CurrentToken();
+    switch (ClassOf(token)) {
+        case TokenClass::Number:
+        case TokenClass::ID:
+            values_.push_back(ast.makeLeaf(token));
+            break;
+        case TokenClass::Lambda:
+        case TokenClass::Plus:
+        case TokenClass::Minus:
+        case TokenClass::Star:
+        case TokenClass::Slash:
+        case TokenClass::Caret:
+        case TokenClass::Function:
+            operators_.push_back(token);
+            break;
+        default:
+            break;
     }
-    throw UnexpectedTokenError(
-        "type " + std::to_string(static_cast<int>(expected)),
-        tokens_[current_index_].value
-    );
+    ++current_index_;
 }
 
-TokenType PDA::GetCurrentToken() const {
-    if (current_index_ < tokens_.size()) {
-        return tokens_[current_index_].type;
+void PDA::Reduce(AST& ast, uint8_t action) {
+    switch (static_cast<Action>(action)) {
+        case Action::Binary: {
+            AST::NodePtr right = PopValue(values_);
+            AST::NodePtr left = PopValue(values_);
+            values_.push_back(ast.makeNode(PopOperator(operators_), std::move(left), std::move(right)));
+            break;
+        }
+        case Action::Negate: {
+            AST::NodePtr operand = PopValue(values_);
+            AST::NodePtr zero = ast.makeLeaf(TokenView{TokenType::Number, "0"});
+            values_.push_back(ast.makeNode(PopOperator(operators_), std::move(zero), std::move(operand)));
+            break;
+        }
+        case Action::Call: {
+            AST::NodePtr argument = PopValue(values_);
+            values_.push_back(ast.makeNode(PopOperator(operators_), std::move(argument), nullptr));
+            break;
+        }
+        case Action::Lambda: {
+            AST::NodePtr body = PopValue(values_);
+            AST::NodePtr parameter = PopValue(values_);
+            values_.push_back(ast.makeNode(PopOperator(operators_), std::move(parameter), std::move(body)));
+            break;
+        }
     }
-    return TokenType::EndOfFile;
 }
 
-bool PDA::Parse() {
+void PDA::Run(AST& ast) {
     if (tokens_.empty()) {
         throw EmptyInputError();
     }
 
-    stack_.push(NonTerminal::E);
+    stack_.clear();
+    values_.clear();
+    operators_.clear();
     current_index_ = 0;
+    stack_.push_back(Symbol(NonTerminal::E));
 
     while (!stack_.empty()) {
-        StackSymbol top = stack_.top();
-        stack_.pop();
+        uint8_t top = stack_.back();
+        stack_.pop_back();
 
-        if (IsTerminal(top)) {
-            TokenType expected = std::get<TokenType>(top);
-            if (!Match(expected)) {
-                return false;
-            }
-        } else {
-            NonTerminal nt = std::get<NonTerminal>(top);
-            TokenType lookahead = GetCurrentToken();
-            std::vector<StackSymbol> rule = SelectRule(nt, lookahead);
-
-            if (rule.empty()) {
-                if (nt == NonTerminal::E_ || nt == NonTerminal::T_) {
-                    continue;
-                }
-                std::string token_val = (current_index_ < tokens_.size())
-                    ? tokens_[current_index_].value
-                    : "EOF";
-                throw NoRuleFoundError(token_val);
-            }
+        if (top >= kActionBase) {
+            Reduce(ast, top - kActionBase);
+            continue;
+        }
+
+        const TokenView& token = CurrentToken();
+        TokenClass lookahead = ClassOf(token);
+        if (lookahead == TokenClass::Invalid) {
+            throw SyntaxError("Unrecognized token: " + std::string(token.value));
+        }
 
-            for (auto it = rule.rbegin(); it != rule.rend(); ++it) {
-                stack_.push(*it);
+        if (top < kNonTerminalBase) {
+            if (top != Symbol(lookahead)) {
+                throw UnexpectedTokenError(kTerminalNames[top], std::string(token.value));
             }
+            Shift(ast);
+            continue;
+        }
+
+        uint8_t production = kParseTable[top - kNonTerminalBase][static_cast<size_t>(lookahead)];
+        if (production == kNoRule) {
+            throw NoRuleFoundError(lookahead == TokenClass::End ? "EOF" : std::string(token.value));
+        }
+        const Rule& rule = kRules[production];
+        for (size_t i = rule.length; i > 0; --i) {
+            stack_.push_back(rule.symbols[i - 1]);
         }
     }
 
-    if (current_index_ < tokens_.size()) {
-        throw UnprocessedTokensError(tokens_[current_index_].value);
+    if (CurrentToken().type != TokenType::EndOfFile) {
+        throw UnprocessedTokensError(std::string(CurrentToken().value));
     }
 
+    ast.setRoot(PopValue(values_));
+}
+
+bool PDA::Parse() {
+    ast_ = AST();
+    Run(ast_);
     return true;
 }
-         
\ No newline at end of file
+
+AST PDA::BuildAST(AST::Allocation allocation) {
+    AST ast(allocation);
+    Run(ast);
+    return ast;
+}
+
+AST PDA::TakeAST() {
+    return std::move(ast_);
+}
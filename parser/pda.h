@@ -1,35 +1,41 @@
 #pragma once
+#include "../ast/ast.h"
 #include "tokenizer.h"
-#include <stack>
-#include <unordered_map>
+#include <cstdint>
 #include <vector>
-#include <variant>
 
-enum class NonTerminal {
+enum class NonTerminal : uint8_t {
     E,
     E_,
     T,
     T_,
-    F
+    P,
+    P_,
+    U,
+    Primary,
 };
 
-using StackSymbol = std::variant<TokenType, NonTerminal>;
-
 class PDA {
   private:
-    std::stack<StackSymbol> stack_;
-    std::unordered_map<NonTerminal, std::vector<std::vector<StackSymbol>>> grammar_;
-    std::vector<Token> tokens_;
+    std::vector<Token> owned_tokens_;
+    std::vector<TokenView> tokens_;
+    std::vector<uint8_t> stack_;
+    std::vector<AST::NodePtr> values_;
+    std::vector<TokenView> operators_;
     size_t current_index_ = 0;
+    AST ast_;
 
-    bool IsTerminal(const StackSymbol& symbol) const;
-    bool IsNonTerminal(const StackSymbol& symbol) const;
-    std::vector<StackSymbol> SelectRule(NonTerminal non_terminal, TokenType lookahead);
-    bool Match(TokenType expected);
-    TokenType GetCurrentToken() const;
-    void InitGrammar();
+    const TokenView& CurrentToken() const;
+    void Shift(AST& ast);
+    void Reduce(AST& ast, uint8_t action);
+    void Run(AST& ast);
 
   public:
     explicit PDA(const std::vector<Token>& input_tokens);
+    explicit PDA(std::vector<TokenView> input_tokens);
+    PDA(const PDA&) = delete;
+    PDA& operator=(const PDA&) = delete;
     bool Parse();
-};
\ No newline at end of file
+    AST BuildAST(AST::Allocation allocation = AST::Allocation::Heap);
+    AST TakeAST();
+};
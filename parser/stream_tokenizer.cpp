@@ -0,0 +1,94 @@
+#include "stream_tokenizer.h"
+#include "char_class.h"
+#include "parser_exceptions.h"
+
+StreamTokenizer::StreamTokenizer(std::istream& input, size_t chunk_size)
+    : input_(input),
+      start_position_(input.tellg()),
+      chunk_size_(chunk_size == 0 ? kDefaultChunkSize : chunk_size) {}
+
+Token StreamTokenizer::nextToken() {
+    return nextTokenView().toToken();
+}
+
+TokenView StreamTokenizer::nextTokenView() {
+    while (true) {
+        std::string_view window(buffer_);
+        window.remove_prefix(index_);
+        Tokenizer tokenizer(window);
+        TokenView token = tokenizer.nextTokenView();
+        size_t token_end = index_ + tokenizer.position();
+
+        if (token.type == TokenType::EndOfFile) {
+            index_ = token_end;
+            if (!exhausted_ && fill()) {
+                continue;
+            }
+            return stabilize(token);
+        }
+
+        if (mayContinue(token, token_end) && !exhausted_) {
+            index_ = static_cast<size_t>(token.value.data() - buffer_.data());
+            fill();
+            continue;
+        }
+
+        index_ = token_end;
+        return stabilize(token);
+    }
+}
+
+void StreamTokenizer::reset() {
+    if (!started_) {
+        return;
+    }
+    if (start_position_ == std::istream::pos_type(-1)) {
+        throw ParserException("Input stream cannot be rewound");
+    }
+    input_.clear();
+    input_.seekg(start_position_);
+    buffer_.clear();
+    index_ = 0;
+    consumed_ = 0;
+    exhausted_ = false;
+    started_ = false;
+}
+
+size_t StreamTokenizer::position() const {
+    return consumed_ + index_;
+}
+
+bool StreamTokenizer::fill() {
+    started_ = true;
+    consumed_ += index_;
+    buffer_.erase(0, index_);
+    index_ = 0;
+    size_t old_size = buffer_.size();
+    buffer_.resize(old_size + chunk_size_);
+    input_.read(&buffer_[old_size], static_cast<std::streamsize>(chunk_size_));
+    size_t read = static_cast<size_t>(input_.gcount());
+    buffer_.resize(old_size + read);
+    if (!input_) {
+        exhausted_ = true;
+    }
+    return read > 0;
+}
+
+bool StreamTokenizer::mayContinue(const TokenView& token, size_t token_end) const {
+    if (token_end != buffer_.size() || token.value.empty()) {
+        return false;
+    }
+    CharClass cls = lexer::ClassOf(token.value.front());
+    return cls == CharClass::Alpha || cls == CharClass::Zero || cls == CharClass::Digit;
+}
+
+TokenView StreamTokenizer::stabilize(const TokenView& token) {
+    std::string_view spelling = Tokenizer::keywordSpelling(token.value);
+    if (!spelling.empty()) {
+        return {token.type, spelling, token.symbol};
+    }
+    std::string& slot = token_slots_[next_slot_];
+    next_slot_ = (next_slot_ + 1) % token_slots_.size();
+    slot.assign(token.value.data(), token.value.size());
+    return {token.type, slot, token.symbol};
+}
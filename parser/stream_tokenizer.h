@@ -0,0 +1,33 @@
+#pragma once
+#include "tokenizer.h"
+#include <array>
+#include <istream>
+#include <string>
+
+class StreamTokenizer : public TokenSource {
+  public:
+    static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+    explicit StreamTokenizer(std::istream& input, size_t chunk_size = kDefaultChunkSize);
+
+    Token nextToken();
+    TokenView nextTokenView() override;
+    void reset() override;
+    size_t position() const override;
+
+  private:
+    std::istream& input_;
+    std::istream::pos_type start_position_;
+    size_t chunk_size_;
+    std::string buffer_;
+    size_t index_ = 0;
+    size_t consumed_ = 0;
+    bool exhausted_ = false;
+    bool started_ = false;
+    std::array<std::string, 2> token_slots_;
+    size_t next_slot_ = 0;
+
+    bool fill();
+    bool mayContinue(const TokenView& token, size_t token_end) const;
+    TokenView stabilize(const TokenView& token);
+};
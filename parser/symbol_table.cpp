@@ -0,0 +1,59 @@
+#include "symbol_table.h"
+
+namespace {
+constexpr std::string_view kLetters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+}
+
+SymbolTable& SymbolTable::global() {
+    static SymbolTable table;
+    return table;
+}
+
+SymbolId SymbolTable::internSlow(std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    SymbolId id = kLetterCount + static_cast<SymbolId>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+std::string_view SymbolTable::name(SymbolId id) const {
+    if (id < kLetterCount) {
+        return kLetters.substr(id, 1);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t index = id - kLetterCount;
+    if (index >= names_.size()) {
+        return {};
+    }
+    return names_[index];
+}
+
+size_t SymbolTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return kLetterCount + names_.size();
+}
+
+void BoundSymbols::bind(SymbolId id) {
+    if (id == kNoSymbol) {
+        return;
+    }
+    if (id >= counts_.size()) {
+        counts_.resize(static_cast<size_t>(id) + 1, 0);
+    }
+    ++counts_[id];
+}
+
+void BoundSymbols::unbind(SymbolId id) {
+    if (id < counts_.size() && counts_[id] > 0) {
+        --counts_[id];
+    }
+}
+
+bool BoundSymbols::isBound(SymbolId id) const {
+    return id < counts_.size() && counts_[id] > 0;
+}
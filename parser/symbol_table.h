@@ -0,0 +1,56 @@
+#pragma once
+#include "char_class.h"
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using SymbolId = uint32_t;
+
+inline constexpr SymbolId kNoSymbol = std::numeric_limits<SymbolId>::max();
+
+class SymbolTable {
+  public:
+    static constexpr SymbolId kLetterCount = 52;
+
+    static SymbolTable& global();
+
+    SymbolId intern(std::string_view name);
+    std::string_view name(SymbolId id) const;
+    size_t size() const;
+
+    static constexpr SymbolId letterSymbol(char ch) {
+        return ch >= 'a' ? static_cast<SymbolId>(ch - 'a')
+                         : static_cast<SymbolId>(ch - 'A') + 26;
+    }
+
+  private:
+    SymbolTable() = default;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string_view, SymbolId> ids_;
+    std::deque<std::string> names_;
+
+    SymbolId internSlow(std::string_view name);
+};
+
+inline SymbolId SymbolTable::intern(std::string_view name) {
+    if (name.size() == 1 && lexer::IsAlpha(name[0])) {
+        return letterSymbol(name[0]);
+    }
+    return internSlow(name);
+}
+
+class BoundSymbols {
+  public:
+    void bind(SymbolId id);
+    void unbind(SymbolId id);
+    bool isBound(SymbolId id) const;
+
+  private:
+    std::vector<uint32_t> counts_;
+};
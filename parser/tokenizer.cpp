@@ -1,34 +1,12 @@
 #include "tokenizer.h"
-#include <regex>
 #include <string>
-#include <cctype>
+#include "char_class.h"
+#include "keywords.h"
 #include "parser_exceptions.h"
 
-const std::unordered_map<std::string_view, TokenType> Tokenizer::kTokenMap = {
-    {"#", TokenType::EndOfFile},
-    {"lambda", TokenType::Lambda},
-    {".", TokenType::Dot},
-    {"+", TokenType::BinaryOperator},
-    {"-", TokenType::BinaryOperator},
-    {"*", TokenType::BinaryOperator},
-    {"/", TokenType::BinaryOperator},
-    {"^", TokenType::BinaryOperator},
-    {"(", TokenType::OpenScope},
-    {")", TokenType::CloseScope},
-    {"sqrt", TokenType::UnaryOperator},
-    {"abs", TokenType::UnaryOperator},
-    {"exp", TokenType::UnaryOperator},
-    {"ln", TokenType::UnaryOperator},
-    {"floor", TokenType::UnaryOperator},
-    {"ceil", TokenType::UnaryOperator},
-    {"round", TokenType::UnaryOperator},
-    {"trunc", TokenType::UnaryOperator},
-    {"sin", TokenType::UnaryOperator},
-    {"cos", TokenType::UnaryOperator},
-    {"tan", TokenType::UnaryOperator},
-    {"ctan", TokenType::UnaryOperator},
-    {"random", TokenType::UnaryOperator}
-};
+Token TokenView::toToken() const {
+    return {type, std::string(value), symbol};
+}
 
 Tokenizer::Tokenizer(std::string_view str) : input_(str), index_(0) {}
 
@@ -36,22 +14,22 @@ bool Tokenizer::isEnd() const {
     return index_ >= input_.size();
 }
 
-TokenType Tokenizer::getType(std::string val) const {
-    if (val == "#") {
-        return TokenType::EndOfFile;
+TokenType Tokenizer::getType(std::string_view val) const {
+    if (val.size() == 1) {
+        if (TokenType type = lexer::SingleCharTokenType(val[0]); type != TokenType::Error) {
+            return type;
+        }
     }
 
-    if (auto it = kTokenMap.find(val); it != kTokenMap.end()) {
-        return it->second;
+    if (const lexer::Keyword* keyword = lexer::FindKeyword(val)) {
+        return keyword->type;
     }
 
-    static const std::regex number_re(R"(^(0|[1-9][0-9]*)(\.[0-9]+)?$)");
-    if (std::regex_match(val, number_re)) {
+    if (lexer::IsNumberLiteral(val)) {
         return TokenType::Number;
     }
 
-    static const std::regex id_re(R"(^[A-Za-z]+$)");
-    if (std::regex_match(val, id_re)) {
+    if (lexer::IsIdentifierWord(val)) {
         return TokenType::ID;
     }
 
@@ -59,93 +37,68 @@ TokenType Tokenizer::getType(std::string val) const {
 }
 
 Token Tokenizer::nextToken() {
+    return nextTokenView().toToken();
+}
+
+TokenView Tokenizer::nextTokenView() {
     skipWhitespace();
 
     if (isEnd()) {
         return {TokenType::EndOfFile, "#"};
     }
 
-    char ch = input_[index_];
-
-    if (isSingleCharToken(ch)) {
-        return readSingleCharToken();
-    }
-
-    if (std::isalpha(static_cast<unsigned char>(ch))) {
-        return readIdentifierOrKeyword();
-    }
-
-    if (std::isdigit(static_cast<unsigned char>(ch))) {
-        return readNumber();
+    switch (lexer::ClassOf(input_[index_])) {
+        case CharClass::Operator:
+        case CharClass::OpenScope:
+        case CharClass::CloseScope:
+        case CharClass::Dot:
+            return readSingleCharToken();
+        case CharClass::Alpha:
+            return readIdentifierOrKeyword();
+        case CharClass::Zero:
+        case CharClass::Digit:
+            return readNumber();
+        default:
+            break;
     }
 
     ++index_;
-    return {TokenType::Error, std::string(1, ch)};
+    return {TokenType::Error, input_.substr(index_ - 1, 1)};
 }
 
 void Tokenizer::skipWhitespace() {
-    while (!isEnd() && std::isspace(static_cast<unsigned char>(input_[index_]))) {
-        ++index_;
-    }
-}
-
-bool Tokenizer::isSingleCharToken(char ch) const {
-    return ch == '+' || ch == '-' || ch == '*' || ch == '/' || 
-           ch == '^' || ch == '(' || ch == ')' || ch == '.';
+    index_ = lexer::SkipSpaces(input_, index_);
 }
 
-Token Tokenizer::readSingleCharToken() {
-    char ch = input_[index_];
+TokenView Tokenizer::readSingleCharToken() {
+    std::string_view token_str = input_.substr(index_, 1);
     ++index_;
-    std::string token_str(1, ch);
-    return {kTokenMap.at(token_str), token_str};
+    return {lexer::SingleCharTokenType(token_str[0]), token_str};
 }
 
-Token Tokenizer::readIdentifierOrKeyword() {
+TokenView Tokenizer::readIdentifierOrKeyword() {
     size_t start = index_;
 
-    while (index_ < input_.size() && std::isalpha(static_cast<unsigned char>(input_[index_]))) {
-        ++index_;
-    }
-
-    std::string word = std::string(input_.substr(start, index_ - start));
+    index_ = lexer::ScanAlpha(input_, index_);
 
-    if (word == "lambda") {
-        return {TokenType::Lambda, word};
-    }
+    std::string_view word = input_.substr(start, index_ - start);
 
-    auto it = kTokenMap.find(word);
-    if (it != kTokenMap.end()) {
-        return {it->second, word};
+    if (const lexer::Keyword* keyword = lexer::FindKeyword(word)) {
+        return {keyword->type, word};
     }
 
     if (word.size() == 1) {
-        return {TokenType::ID, word};
+        return {TokenType::ID, word, SymbolTable::global().intern(word)};
     }
     return {TokenType::Error, word};
 }
 
-Token Tokenizer::readNumber() {
+TokenView Tokenizer::readNumber() {
     size_t start = index_;
-    bool has_dot = false;
-    while (index_ < input_.size()) {
-        char ch = input_[index_];
-
-        if (std::isdigit(static_cast<unsigned char>(ch))) {
-            ++index_;
-        } else if (ch == '.' && !has_dot) {
-            has_dot = true;
-            ++index_;
-        } else {
-            break;
-        }
-    }
-
-    std::string num = std::string(input_.substr(start, index_ - start));
+    index_ = lexer::ScanNumber(input_, index_);
+    std::string_view num = input_.substr(start, index_ - start);
 
-    TokenType type = getType(num);
-
-    if (type != TokenType::Number) {
+    if (!lexer::IsNumberLiteral(num)) {
         return {TokenType::Error, num};
     }
 
@@ -156,13 +109,35 @@ void Tokenizer::reset() {
     index_ = 0;
 }
 
+size_t Tokenizer::position() const {
+    return index_;
+}
+
+std::string_view Tokenizer::keywordSpelling(std::string_view word) {
+    if (word.size() == 1 && lexer::SingleCharTokenType(word[0]) != TokenType::Error) {
+        return lexer::ByteSpelling(word[0]);
+    }
+    if (const lexer::Keyword* keyword = lexer::FindKeyword(word)) {
+        return keyword->spelling;
+    }
+    return {};
+}
+
 std::vector<Token> Tokenizer::tokenizeAll() {
     std::vector<Token> tokens;
+    for (const TokenView& view : tokenizeAllViews()) {
+        tokens.push_back(view.toToken());
+    }
+    return tokens;
+}
+
+std::vector<TokenView> Tokenizer::tokenizeAllViews() {
+    std::vector<TokenView> tokens;
     reset();
     while (true) {
-        Token token = nextToken();
+        TokenView token = nextTokenView();
         if (token.type == TokenType::Error) {
-            throw SyntaxError("Unrecognized token: " + token.value);
+            throw SyntaxError("Unrecognized token: " + std::string(token.value));
         }
         tokens.push_back(token);
         if (token.type == TokenType::EndOfFile) {
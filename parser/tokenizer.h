@@ -1,7 +1,7 @@
 #pragma once
+#include "symbol_table.h"
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
 enum class TokenType {
@@ -20,24 +20,43 @@ enum class TokenType {
 struct Token {
     TokenType type;
     std::string value;
+    SymbolId symbol = kNoSymbol;
 };
 
-class Tokenizer {
+struct TokenView {
+    TokenType type;
+    std::string_view value;
+    SymbolId symbol = kNoSymbol;
+
+    Token toToken() const;
+};
+
+class TokenSource {
+  public:
+    virtual ~TokenSource() = default;
+    virtual TokenView nextTokenView() = 0;
+    virtual void reset() = 0;
+    virtual size_t position() const = 0;
+};
+
+class Tokenizer : public TokenSource {
   private:
     std::string_view input_;
     size_t index_ = 0;
-    static const std::unordered_map<std::string_view, TokenType> kTokenMap;
 
     bool isEnd() const;
     void skipWhitespace();
-    bool isSingleCharToken(char ch) const;
-    Token readSingleCharToken();
-    Token readIdentifierOrKeyword();
-    Token readNumber();
+    TokenView readSingleCharToken();
+    TokenView readIdentifierOrKeyword();
+    TokenView readNumber();
   public:
     Tokenizer(std::string_view str);
-    TokenType getType(std::string val) const;
+    TokenType getType(std::string_view val) const;
     Token nextToken();
-    void reset();
+    TokenView nextTokenView() override;
+    void reset() override;
+    size_t position() const override;
+    static std::string_view keywordSpelling(std::string_view word);
     std::vector<Token> tokenizeAll();
+    std::vector<TokenView> tokenizeAllViews();
 };
@@ -1,14 +1,39 @@
+#include "../analysis/corpus_subexpression_index.h"
 #include "../analysis/msp_checker.h"
 #include "../analysis/subexpression_finder.h"
+#include "../ast/ac_normal_form.h"
 #include "../ast/ast.h"
+#include "../ast/binary_ast.h"
+#include "../ast/canonical_text.h"
+#include "../ast/de_bruijn_hashes.h"
+#include "../ast/flat_ast.h"
+#include "../ast/persistent_ast.h"
+#include "../ast/hash_cons_table.h"
+#include "../parser/batch_parser.h"
+#include "../parser/incremental_parser.h"
 #include "../parser/parser.h"
 #include "../parser/parser_exceptions.h"
+#include "../parser/pda.h"
+#include "../parser/stream_tokenizer.h"
+#include "../parser/symbol_table.h"
 #include "../parser/tokenizer.h"
+#include "../util/mapped_file.h"
 #include "../util/subtree_utils.h"
+#include "../util/work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace {
@@ -76,6 +101,218 @@ void TestTokenizerRejectsUnknownIdentifiers() {
     });
 }
 
+void TestTokenizerViewsReferenceInput() {
+    std::string input = "sin(x) * 12.5";
+    Tokenizer tokenizer(input);
+    auto tokens = tokenizer.tokenizeAllViews();
+    assert(tokens.size() == 7);
+    assert(tokens[0].type == TokenType::UnaryOperator && tokens[0].value == "sin");
+    assert(tokens[0].value.data() == input.data());
+    assert(tokens[2].type == TokenType::ID && tokens[2].value.data() == input.data() + 4);
+    assert(tokens[5].type == TokenType::Number && tokens[5].value == "12.5");
+    assert(tokens[5].value.data() == input.data() + 9);
+    assert(tokens[6].type == TokenType::EndOfFile);
+}
+
+void TestTokenizerNumberLiterals() {
+    Tokenizer tokenizer("");
+    assert(tokenizer.getType("0") == TokenType::Number);
+    assert(tokenizer.getType("10.25") == TokenType::Number);
+    assert(tokenizer.getType("0.5") == TokenType::Number);
+    assert(tokenizer.getType("01") == TokenType::Error);
+    assert(tokenizer.getType("1.") == TokenType::Error);
+    assert(tokenizer.getType(".5") == TokenType::Error);
+    assert(tokenizer.getType("xy") == TokenType::ID);
+
+    Tokenizer scanner("1.2.3 007 12345678901234567890");
+    Token first = scanner.nextToken();
+    assert(first.type == TokenType::Number && first.value == "1.2");
+    Token dot = scanner.nextToken();
+    assert(dot.type == TokenType::Dot);
+    assert(scanner.nextToken().value == "3");
+    Token leading_zero = scanner.nextToken();
+    assert(leading_zero.type == TokenType::Error && leading_zero.value == "007");
+    Token long_number = scanner.nextToken();
+    assert(long_number.type == TokenType::Number && long_number.value == "12345678901234567890");
+}
+
+void TestTokenizerKeywordLookup() {
+    Tokenizer tokenizer("");
+    for (const char* keyword : {"sqrt", "abs", "exp", "ln", "floor", "ceil", "round",
+                                "trunc", "sin", "cos", "tan", "ctan", "random"}) {
+        assert(tokenizer.getType(keyword) == TokenType::UnaryOperator);
+        assert(Tokenizer::keywordSpelling(keyword) == keyword);
+    }
+    assert(tokenizer.getType("lambda") == TokenType::Lambda);
+    assert(tokenizer.getType("#") == TokenType::EndOfFile);
+    assert(tokenizer.getType("^") == TokenType::BinaryOperator);
+    assert(tokenizer.getType(")") == TokenType::CloseScope);
+    assert(Tokenizer::keywordSpelling("ctn").empty());
+
+    Tokenizer words("sinx lambd ln tan");
+    assert(words.nextToken().type == TokenType::Error);
+    assert(words.nextToken().type == TokenType::Error);
+    assert(words.nextToken().type == TokenType::UnaryOperator);
+    assert(words.nextToken().type == TokenType::UnaryOperator);
+}
+
+void TestPDAAcceptsTokenViews() {
+    std::string input = "2 * x + (3 - y)";
+    Tokenizer tokenizer(input);
+    PDA pda(tokenizer.tokenizeAllViews());
+    assert(pda.Parse());
+
+    PDA owning(tokenizer.tokenizeAll());
+    assert(owning.Parse());
+    assert(util::CanonicalForm(owning.TakeAST().getRoot()) == "+(*(2,x),-(3,y))");
+}
+
+void TestPDABuildsSameASTAsParser() {
+    const std::vector<std::string> inputs = {
+        "a - b - c",
+        "x ^ y ^ -z",
+        "-x ^ 2 * +y / 3",
+        "sin(x + 1) * cos(-y)",
+        "lambda x. x ^ 2 + lambda y. y",
+        "(lambda f. f * 2) - sqrt(((a)))",
+        "2 * x + 3 * x - 2 * x",
+    };
+    for (const auto& input : inputs) {
+        Parser parser(input);
+        Tokenizer tokenizer(input);
+        PDA pda(tokenizer.tokenizeAllViews());
+        AST ast = pda.BuildAST(AST::Allocation::Arena);
+        assert(util::CanonicalForm(ast.getRoot()) == util::CanonicalForm(parser.buildAST().getRoot()));
+        assert(ast.getRoot()->left->parent.lock() == ast.getRoot());
+    }
+
+    for (std::string input : {"a b", "(a + b", "sin x", "a * )", "lambda 1 . x", "+"}) {
+        Tokenizer tokenizer(input);
+        PDA pda(tokenizer.tokenizeAllViews());
+        ExpectThrows<ParserException>([&] { pda.Parse(); });
+    }
+}
+
+void TestStreamTokenizerSplitsAcrossChunks() {
+    std::string input = "lambda x. sqrt(x) + 123.456 * yy - 10.5 ^ 2";
+    Tokenizer reference(input);
+    std::vector<Token> expected;
+    do {
+        expected.push_back(reference.nextToken());
+    } while (expected.back().type != TokenType::EndOfFile);
+    for (size_t chunk_size : {1, 2, 3, 7, 64}) {
+        std::istringstream stream(input);
+        StreamTokenizer tokenizer(stream, chunk_size);
+        for (const auto& token : expected) {
+            Token actual = tokenizer.nextToken();
+            assert(actual.type == token.type);
+            assert(actual.value == token.value);
+        }
+    }
+}
+
+void TestParserReadsFromStream() {
+    std::istringstream stream("(a + b) * cos(12.75) - lambda x. x ^ 2");
+    Parser parser(stream);
+    AST ast = parser.buildAST();
+    Parser reference("(a + b) * cos(12.75) - lambda x. x ^ 2");
+    AST expected = reference.buildAST();
+    assert(util::CanonicalForm(ast.getRoot()) == util::CanonicalForm(expected.getRoot()));
+    AST again = parser.buildAST();
+    assert(util::CanonicalForm(again.getRoot()) == util::CanonicalForm(expected.getRoot()));
+}
+
+void TestParserReadsFromMappedFile() {
+    std::string path = "lab2_mapped_input.txt";
+    {
+        std::ofstream out(path);
+        out << "2 * x + 3 * x";
+    }
+    {
+        util::MappedFile file(path);
+        assert(file.view() == "2 * x + 3 * x");
+        Parser parser(std::make_unique<Tokenizer>(file.view()));
+        AST ast = parser.buildAST();
+        assert(util::CanonicalForm(ast.getRoot()) == "+(*(2,x),*(3,x))");
+    }
+    std::remove(path.c_str());
+}
+
+void TestBinaryASTRoundTripsThroughMappedFile() {
+    const std::string source = "lambda x. sqrt(x * 2.5) + -z ^ (x - 2.5) / cos(y)";
+    Parser parser(source);
+    AST ast = parser.buildAST();
+    std::string path = "lab2_binary_ast.bin";
+    BinaryAST::save(ast, path);
+    {
+        BinaryAST loaded(path);
+        assert(loaded.nodeCount() == ast.LRCTraversal().size());
+
+        BinaryAST::Node root = loaded.root();
+        assert(root.token().type == TokenType::Lambda);
+        assert(root.left().token().value == "x");
+        BinaryAST::Node sum = root.right();
+        assert(sum.token().value == "+");
+        assert(sum.left().token().value == "sqrt");
+        assert(sum.left().left().right().token().value == "2.5");
+        assert(sum.right().token().value == "/");
+        assert(sum.right().right().left().token().symbol == SymbolTable::global().intern("y"));
+        assert(!sum.left().right());
+
+        AST restored = loaded.toAST(AST::Allocation::Arena);
+        assert(util::CanonicalForm(restored.getRoot()) == util::CanonicalForm(ast.getRoot()));
+    }
+    std::remove(path.c_str());
+
+    assert(!BinaryAST::fromBytes(BinaryAST::encode(AST())).root());
+}
+
+void TestBinaryASTRejectsCorruptInput() {
+    Parser parser("(a + b) * 3");
+    std::string bytes = BinaryAST::encode(parser.buildAST());
+    ExpectThrows<std::runtime_error>([&] { BinaryAST::fromBytes(bytes.substr(0, 10)); });
+
+    std::string future = bytes;
+    future[4] = 9;
+    ExpectThrows<std::runtime_error>([&] { BinaryAST::fromBytes(future); });
+
+    std::string truncated = bytes;
+    truncated[16] = static_cast<char>(bytes.size());
+    ExpectThrows<std::runtime_error>([&] { BinaryAST::fromBytes(truncated); });
+
+    std::string inflated = bytes;
+    inflated[15] = static_cast<char>(0x7f);
+    ExpectThrows<std::runtime_error>([&] { BinaryAST::fromBytes(inflated); });
+
+    std::string bad_opcode = bytes;
+    bad_opcode[32] = 0x3f;
+    BinaryAST loaded = BinaryAST::fromBytes(bad_opcode);
+    ExpectThrows<std::runtime_error>([&] { loaded.root(); });
+}
+
+void TestSymbolTableInternsIdentifiers() {
+    SymbolTable& table = SymbolTable::global();
+    assert(table.intern("a") == 0);
+    assert(table.intern("Z") == SymbolTable::kLetterCount - 1);
+    SymbolId alpha = table.intern("alpha");
+    assert(alpha >= SymbolTable::kLetterCount);
+    assert(table.intern("alpha") == alpha);
+    assert(table.name(alpha) == "alpha");
+    assert(table.name(table.intern("q")) == "q");
+
+    Tokenizer tokenizer("x + y * x");
+    auto tokens = tokenizer.tokenizeAll();
+    assert(tokens[0].symbol == table.intern("x"));
+    assert(tokens[2].symbol == table.intern("y"));
+    assert(tokens[0].symbol == tokens[4].symbol);
+    assert(tokens[1].symbol == kNoSymbol);
+
+    auto leaf = AST::createLeaf(Token{TokenType::ID, "k"});
+    assert(leaf->token.symbol == table.intern("k"));
+    assert(util::IsClosedSubtree(leaf, {"k"}));
+    assert(!util::IsClosedSubtree(leaf, {"j"}));
+}
+
 void TestParserStructureAndPrecedence() {
     Parser parser("2 + 3 * 4");
     AST ast = parser.buildAST();
@@ -216,6 +453,361 @@ void TestASTTraversals() {
     assert(pre_values == expected_pre);
 }
 
+template <typename Range>
+std::string JoinValues(const Range& range) {
+    std::string joined;
+    for (const AST::Node& node : range) {
+        joined += node.token.value;
+    }
+    return joined;
+}
+
+template <typename Tree, typename = void>
+struct CanTraverse : std::false_type {};
+
+template <typename Tree>
+struct CanTraverse<Tree, std::void_t<decltype(std::declval<Tree>().postOrder())>> : std::true_type {};
+
+void TestASTLazyTraversalRanges() {
+    Parser parser("(a + b) * sin(c) - d / e");
+    AST ast = parser.buildAST();
+    assert(JoinValues(ast.inOrder()) == "a+b*csin-d/e");
+    assert(JoinValues(ast.postOrder()) == "ab+csin*de/-");
+    assert(JoinValues(ast.preOrder()) == "-*+absinc/de");
+    assert(JoinValues(ast.levelOrder()) == "-*/+sindeabc");
+    AST empty;
+    assert(JoinValues(empty.postOrder()).empty());
+    static_assert(CanTraverse<const AST&>::value && !CanTraverse<AST>::value);
+
+    size_t visited = 0;
+    for (const AST::Node& node : ast.preOrder()) {
+        ++visited;
+        if (node.token.value == "sin") {
+            break;
+        }
+    }
+    assert(visited == 6);
+
+    Parser shared("x * x + x * x");
+    AST dag = shared.buildAST(AST::Allocation::Heap, AST::Sharing::HashConsed);
+    assert(JoinValues(dag.postOrder()) == "xx*xx*+");
+    assert(JoinValues(dag.inOrder()) == "x*x+x*x");
+}
+
+void TestASTTraversalsOnDeepTrees() {
+    const size_t depth = 1000000;
+    std::string chain = "x";
+    for (size_t i = 0; i < depth; ++i) {
+        chain += "-x";
+    }
+    Parser parser(chain);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    assert(ast.height() == depth + 1);
+    assert(ast.LRCTraversal().size() == 2 * depth + 1);
+    size_t leaves = 0;
+    for (const AST::Node& node : ast.inOrder()) {
+        leaves += node.isLeaf() ? 1 : 0;
+    }
+    assert(leaves == depth + 1);
+    assert(ast.postOrder().begin()->isLeaf());
+}
+
+void TestPersistentASTSharesUntouchedSubtrees() {
+    Parser parser("(a + b) * (c - d) + sin(e / 2)");
+    PersistentAST base = PersistentAST::fromAST(parser.buildAST());
+    assert(base.nodeCount() == 12);
+
+    PersistentAST::Cursor cursor = base.cursor();
+    assert(cursor.left() && cursor.right() && cursor.left());
+    assert(cursor.node().token.value == "c");
+    assert(cursor.depth() == 3);
+    assert(!cursor.left());
+
+    PersistentAST::NodePtr replacement = PersistentAST::makeNode(
+        TokenView{TokenType::BinaryOperator, "*"}, PersistentAST::makeLeaf(TokenView{TokenType::ID, "x"}),
+        PersistentAST::makeLeaf(TokenView{TokenType::Number, "3"}));
+    PersistentAST edited = base.replace(cursor, replacement);
+
+    assert(util::CanonicalForm(base.toAST().getRoot()) == "+(*(+(a,b),-(c,d)),sin(/(e,2)))");
+    assert(util::CanonicalForm(edited.toAST().getRoot()) == "+(*(+(a,b),-(*(3,x),d)),sin(/(e,2)))");
+    assert(edited.nodeCount() == 14);
+    assert(edited.root() != base.root());
+    assert(edited.root()->right == base.root()->right);
+    assert(edited.root()->left->left == base.root()->left->left);
+    assert(edited.root()->left->right->right == base.root()->left->right->right);
+    assert(edited.root()->left->right->left == replacement);
+
+    assert(cursor.up() && cursor.up() && cursor.up());
+    assert(!cursor.up());
+    ExpectThrows<std::invalid_argument>([&] { edited.replace(cursor, replacement); });
+
+    PersistentAST chained = edited;
+    for (int i = 0; i < 100; ++i) {
+        PersistentAST::Cursor leaf = chained.cursor();
+        leaf.right();
+        leaf.left();
+        chained = chained.replace(leaf, PersistentAST::makeLeaf(TokenView{TokenType::Number, std::to_string(i)}));
+    }
+    assert(chained.root()->left == edited.root()->left);
+    assert(util::CanonicalForm(edited.toAST().getRoot()) == "+(*(+(a,b),-(*(3,x),d)),sin(/(e,2)))");
+
+    static_assert(std::is_const_v<std::remove_reference_t<decltype((edited.root()->left->left->token))>>);
+    static_assert(std::is_same_v<decltype(edited.root()->left), PersistentAST::NodePtr>);
+    PersistentAST::Cursor nowhere = PersistentAST().cursor();
+    assert(!nowhere && !nowhere.left() && !nowhere.right() && !nowhere.up());
+
+    std::string chain = "x";
+    for (int i = 0; i < 200000; ++i) {
+        chain += " - x";
+    }
+    Parser deep(chain);
+    PersistentAST long_chain = PersistentAST::fromAST(deep.buildAST());
+    assert(long_chain.root()->height == 200001);
+    assert(long_chain.toAST().height() == 200001);
+}
+
+void TestParserArenaAllocation() {
+    Parser parser("(a + b) * sin(c) - lambda x. x ^ 2");
+    AST heap = parser.buildAST();
+    AST arena = parser.buildAST(AST::Allocation::Arena);
+    assert(heap.allocation() == AST::Allocation::Heap);
+    assert(arena.allocation() == AST::Allocation::Arena);
+    assert(heap.arenaBytes() == 0);
+    assert(arena.arenaBytes() > 0);
+    assert(util::CanonicalForm(heap.getRoot()) == util::CanonicalForm(arena.getRoot()));
+    assert(arena.getRoot()->left->parent.lock() == arena.getRoot());
+
+    AST::NodePtr survivor;
+    {
+        AST scoped = parser.buildAST(AST::Allocation::Arena);
+        survivor = scoped.getRoot()->left;
+    }
+    assert(util::CanonicalForm(survivor) == "*(+(a,b),sin(c))");
+}
+
+void TestParserOperatorAssociativity() {
+    Parser parser("a - b - c * d / e ^ f ^ -g");
+    AST ast = parser.buildAST();
+    assert(util::CanonicalForm(ast.getRoot()) == "-(-(a,b),/(*(c,d),^(e,^(f,-(0,g)))))");
+}
+
+void TestParserUnboundedNesting() {
+    const size_t depth = 1000000;
+    std::string nested(depth, '(');
+    nested += "x";
+    nested.append(depth, ')');
+    Parser parenthesized(nested);
+    AST ast = parenthesized.buildAST();
+    assert(ast.getRoot()->isLeaf());
+    assert(ast.getRoot()->token.value == "x");
+
+    std::string chain = "x";
+    for (size_t i = 0; i < depth; ++i) {
+        chain += "^-x";
+    }
+    Parser right_nested(chain);
+    AST tower = right_nested.buildAST(AST::Allocation::Arena);
+    size_t levels = 0;
+    AST::Node* node = tower.getRoot().get();
+    for (; node->token.value == "^"; node = node->right.get()) {
+        assert(levels == 0 || node->left->token.value == "-");
+        ++levels;
+    }
+    assert(levels == depth);
+    assert(node->token.value == "-");
+}
+
+void TestParserTryBuildReportsStructuredErrors() {
+    Parser valid("sin(x) + 2");
+    ParseResult result = valid.tryBuildAST();
+    assert(result);
+    assert(util::CanonicalForm(result.value().getRoot()) == "+(2,sin(x))");
+
+    struct Case {
+        std::string input;
+        ParseErrorCode code;
+        size_t offset;
+        std::string span;
+    };
+    const std::vector<Case> cases = {
+        {"a + $", ParseErrorCode::UnrecognizedToken, 4, "$"},
+        {"(a + b", ParseErrorCode::ExpectedToken, 6, ""},
+        {"sin x", ParseErrorCode::ExpectedToken, 4, "x"},
+        {"a * )", ParseErrorCode::UnexpectedToken, 4, ")"},
+        {"a b", ParseErrorCode::UnprocessedTokens, 2, "b"},
+        {"lambda 1 . x", ParseErrorCode::ExpectedToken, 7, "1"},
+        {"2 + 01.5", ParseErrorCode::UnrecognizedToken, 4, "01.5"},
+    };
+    for (const auto& test : cases) {
+        Parser parser(test.input);
+        ParseResult failure = parser.tryBuildAST(AST::Allocation::Arena);
+        assert(!failure.ok());
+        assert(failure.error().code == test.code);
+        assert(failure.error().offset == test.offset);
+        assert(failure.error().span(test.input) == test.span);
+
+        std::string thrown;
+        try {
+            parser.buildAST();
+        } catch (const ParserException& error) {
+            thrown = error.what();
+        }
+        assert(failure.error().message(test.input) == thrown);
+
+        std::string rethrown;
+        try {
+            failure.value();
+        } catch (const ParserException& error) {
+            rethrown = error.what();
+        }
+        assert(rethrown == thrown);
+    }
+
+    std::istringstream stream("x * (y - 1");
+    Parser streamed(stream);
+    ParseResult unterminated = streamed.tryBuildAST();
+    assert(unterminated.error().code == ParseErrorCode::ExpectedToken);
+    assert(unterminated.error().offset == 10);
+    ExpectThrows<UnexpectedTokenError>([&] { unterminated.value(); });
+}
+
+void TestParserRecordsSourceSpans() {
+    std::string input = "x * (y - 1) + sin( z )";
+    Parser parser(input);
+    AST ast = parser.buildAST();
+    AST::NodePtr root = ast.getRoot();
+    assert(root->offset == 0 && root->length == input.size());
+    AST::NodePtr product = root->left;
+    assert(product->offset == 0 && product->length == 11);
+    assert(input.substr(product->right->offset, product->right->length) == "(y - 1)");
+    AST::NodePtr call = root->right;
+    assert(input.substr(call->offset, call->length) == "sin( z )");
+    assert(call->left->offset == 3 && call->left->length == 5);
+}
+
+void TestIncrementalReparseReusesUntouchedSubtrees() {
+    std::string source;
+    for (int i = 0; i < 200; ++i) {
+        source += i == 0 ? "" : " + ";
+        source += "(a * b - sin(c / " + std::to_string(i + 1) + "))";
+    }
+    Parser parser(source);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    AST::NodePtr untouched = ast.getRoot()->right;
+    AST::NodePtr spine = ast.getRoot()->left;
+    AST before = ast;
+    std::string before_form = util::CanonicalForm(before.getRoot());
+    StructuralHash before_hash = before.getRoot()->hash;
+
+    size_t target = source.find("c / 57");
+    TextEdit edit{target, 1, "(c + d)"};
+    ReparseResult result = IncrementalParser::reparse(std::move(ast), source, edit);
+    assert(!result.full_reparse);
+    assert(result.reparsed_bytes < 32);
+    assert(result.ast.getRoot()->right->left == untouched->left);
+    assert(result.ast.getRoot()->right->right == untouched->right);
+    assert(result.ast.getRoot()->left->right->right == spine->right->right);
+
+    assert(before.getRoot()->left == spine && before.getRoot()->right == untouched);
+    assert(before.getRoot()->length == source.size());
+    assert(untouched->offset + untouched->length == source.size());
+    assert(before.getRoot()->hash == before_hash);
+    assert(util::CanonicalForm(before.getRoot()) == before_form);
+
+    Parser fresh(result.source);
+    AST expected = fresh.buildAST();
+    assert(util::CanonicalForm(result.ast.getRoot()) == util::CanonicalForm(expected.getRoot()));
+    assert(result.ast.getRoot()->node_count == expected.getRoot()->node_count);
+    assert(result.ast.getRoot()->hash == expected.getRoot()->hash);
+    assert(result.ast.getRoot()->free_symbols == expected.getRoot()->free_symbols);
+
+    TextEdit precedence = IncrementalParser::difference(result.source, "a + b * c");
+    ReparseResult rewritten = IncrementalParser::reparse(std::move(result.ast), result.source, precedence);
+    assert(rewritten.source == "a + b * c");
+    TextEdit flip = IncrementalParser::difference(rewritten.source, "a + b + c");
+    assert(flip.offset == 6 && flip.removed == 1 && flip.inserted == "+");
+    ReparseResult flipped = IncrementalParser::reparse(std::move(rewritten.ast), rewritten.source, flip);
+    assert(flipped.full_reparse);
+    assert(util::CanonicalForm(flipped.ast.getRoot()) == "+(+(a,b),c)");
+
+    for (const auto& [before, after] : {std::pair<std::string, std::string>{"y + 1", "-lambda x. x + 1"},
+                                        {"y + 1", "-lambda z. z * 2 + 1"},
+                                        {"y * 2 + 1", "-lambda z. z * 2 + 1"}}) {
+        Parser original(before);
+        TextEdit negate = IncrementalParser::difference(before, after);
+        ReparseResult negated = IncrementalParser::reparse(original.buildAST(), before, negate);
+        assert(negated.source == after);
+        Parser reference(after);
+        assert(util::CanonicalForm(negated.ast.getRoot()) == util::CanonicalForm(reference.buildAST().getRoot()));
+    }
+
+    ExpectThrows<ParserException>([&] {
+        IncrementalParser::reparse(std::move(flipped.ast), flipped.source, TextEdit{4, 0, ")"});
+    });
+}
+
+void TestWorkStealingPoolRunsEveryTask() {
+    util::WorkStealingPool pool(4);
+    assert(pool.threadCount() == 4);
+    for (size_t round = 0; round < 3; ++round) {
+        std::vector<std::atomic<int>> hits(1000);
+        pool.run(hits.size(), [&](size_t task, size_t worker) {
+            assert(worker < pool.threadCount());
+            ++hits[task];
+        });
+        for (const auto& hit : hits) {
+            assert(hit.load() == 1);
+        }
+    }
+    ExpectThrows<std::runtime_error>([&] {
+        pool.run(8, [](size_t task, size_t) {
+            if (task == 5) {
+                throw std::runtime_error("task failed");
+            }
+        });
+    });
+}
+
+void TestBatchParserPreservesInputOrder() {
+    std::vector<std::string> inputs;
+    std::string large = "x";
+    for (int i = 0; i < 2000; ++i) {
+        large += " + (y * " + std::to_string(i) + ")";
+    }
+    inputs.push_back("a + b");
+    inputs.push_back(large);
+    for (int i = 0; i < 500; ++i) {
+        inputs.push_back(i % 7 == 0 ? "(a + " : "sin(x) * " + std::to_string(i));
+    }
+
+    BatchParser::Options options;
+    options.threads = 4;
+    options.large_input_bytes = 1024;
+    options.batch_bytes = 64;
+    BatchParser batch(options);
+    auto results = batch.parse(inputs);
+    assert(results.size() == inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        std::string expected;
+        try {
+            Parser parser(inputs[i]);
+            expected = util::CanonicalForm(parser.buildAST().getRoot());
+        } catch (const ParserException& error) {
+            assert(!results[i].ok());
+            assert(results[i].error().message(inputs[i]) == error.what());
+            continue;
+        }
+        assert(results[i].ok());
+        assert(results[i].value().allocation() == AST::Allocation::Arena);
+        assert(util::CanonicalForm(results[i].value().getRoot()) == expected);
+    }
+
+    Parser alone(inputs[0]);
+    assert(results[0].value().arenaBytes() == alone.buildAST(AST::Allocation::Arena).arenaBytes());
+    assert(results[0].value().arenaBytes() < results[1].value().arenaBytes());
+    assert(results[0].value().arena() != results[3].value().arena());
+}
+
 void TestASTSetRootResetsParent() {
     AST ast;
     auto node = AST::createLeaf(Token{TokenType::Number, "1"});
@@ -226,6 +818,120 @@ void TestASTSetRootResetsParent() {
     assert(ast.empty());
 }
 
+void TestFlatASTRoundTripsInPostOrder() {
+    Parser parser("lambda x. sqrt(x * 2) + -y ^ 3");
+    AST ast = parser.buildAST();
+    FlatAST flat(ast);
+
+    auto post_order = ast.LRCTraversal();
+    assert(flat.size() == post_order.size());
+    for (FlatAST::Index i = 0; i < flat.size(); ++i) {
+        TokenView token = flat.token(i);
+        assert(token.type == post_order[i]->token.type);
+        assert(token.value == post_order[i]->token.value);
+        for (FlatAST::Index child : {flat.left(i), flat.right(i)}) {
+            if (child != FlatAST::kNone) {
+                assert(child < i);
+                assert(flat.parent(child) == i);
+            }
+        }
+    }
+    assert(flat.parent(flat.root()) == FlatAST::kNone);
+    assert(flat.opcode(flat.root()) == FlatAST::Opcode::Lambda);
+    assert(flat.subtreeBegin(flat.root()) == 0);
+
+    AST restored = flat.toAST(AST::Allocation::Arena);
+    assert(util::CanonicalForm(restored.getRoot()) == util::CanonicalForm(ast.getRoot()));
+    assert(restored.getRoot()->right->parent.lock() == restored.getRoot());
+
+    for (FlatAST::Index i = 0; i < flat.size(); ++i) {
+        assert(util::NodeCount(flat, i) == post_order[i]->node_count);
+    }
+    std::string chain = "x";
+    for (int i = 0; i < 200000; ++i) {
+        chain += " - x";
+    }
+    Parser deep(chain);
+    FlatAST left_deep(deep.buildAST());
+    size_t total = 0;
+    for (FlatAST::Index i = 0; i < left_deep.size(); ++i) {
+        total += util::NodeCount(left_deep, i);
+    }
+    assert(total == 200001 + 200000 + size_t{200000} * 200001);
+}
+
+void TestASTCachesSynthesizedAttributes() {
+    Parser parser("lambda x. (x + y) * sqrt(2 + x) - (y + x)");
+    AST ast = parser.buildAST();
+    AST::NodePtr root = ast.getRoot();
+    assert(root->height == ast.height());
+    assert(root->node_count == ast.LRCTraversal().size());
+    assert(root->free_symbols == uint64_t{1} << SymbolTable::global().intern("y"));
+    assert(!util::IsClosedSubtree(root));
+    assert(util::IsClosedSubtree(root, {"y"}));
+
+    AST::NodePtr difference = root->right;
+    assert(difference->height == 5);
+    assert(difference->node_count == 12);
+    AST::NodePtr sum = difference->left->left;
+    AST::NodePtr swapped = difference->right;
+    assert(sum->hash == swapped->hash);
+    assert(sum->hash != difference->left->right->left->hash);
+
+    Parser other("(x - y) + (y - x)");
+    AST::NodePtr pair = other.buildAST().getRoot();
+    assert(pair->left->hash != pair->right->hash);
+    assert(pair->left->free_symbols == pair->right->free_symbols);
+}
+
+void TestCanonicalTextRecordsSubtreeSpans() {
+    Parser parser("(c * b + sin(a)) * (b * c + 12) - lambda x. x + 1 + (1 + x)");
+    AST ast = parser.buildAST();
+    FlatAST flat(ast);
+    std::vector<std::string> forms;
+    for (FlatAST::Index i = 0; i < flat.size(); ++i) {
+        forms.push_back(util::CanonicalForm(flat, i));
+    }
+    CanonicalText text(ast.getRoot());
+    assert(text.text() == forms.back());
+    assert(text.text().size() == CanonicalText::length(*ast.getRoot()));
+
+    auto nodes = ast.LRCTraversal();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        assert(text.contains(*nodes[i]));
+        assert(text.of(*nodes[i]) == forms[i]);
+        assert(CanonicalText::print(*nodes[i]) == forms[i]);
+        assert(CanonicalText::length(*nodes[i]) == forms[i].size());
+        for (size_t j = 0; j < nodes.size(); ++j) {
+            int expected = forms[i] < forms[j] ? -1 : (forms[j] < forms[i] ? 1 : 0);
+            assert(CanonicalText::compare(*nodes[i], *nodes[j]) == expected);
+        }
+    }
+    assert(text.of(*ast.getRoot()->left) == "*(+(*(b,c),12),+(*(b,c),sin(a)))");
+
+    Parser other("a + b");
+    AST foreign = other.buildAST();
+    assert(!text.contains(*foreign.getRoot()));
+    assert(text.of(*foreign.getRoot()).empty());
+    assert(CanonicalText().text().empty());
+}
+
+void TestCanonicalTextOnDeepTrees() {
+    const size_t depth = 200000;
+    std::string chain = "x";
+    for (size_t i = 0; i < depth; ++i) {
+        chain += i % 2 == 0 ? "+y" : "+x";
+    }
+    Parser parser(chain);
+    AST ast = parser.buildAST(AST::Allocation::Arena);
+    CanonicalText text(ast.getRoot());
+    assert(text.text().size() == CanonicalText::length(*ast.getRoot()));
+    assert(text.text() == util::CanonicalForm(ast.getRoot()));
+    assert(text.text().substr(0, 6) == "+(+(+(");
+    assert(text.text().substr(text.text().size() - 6) == ",y),x)");
+    assert(text.of(*ast.getRoot()->right) == "x");
+}
+
 void TestUtilCanonicalForm() {
     Parser parser("(a + b) + (b + a)");
     AST ast = parser.buildAST();
@@ -268,6 +974,19 @@ void TestUtilCollectNodesPreOrder() {
     assert(values == expected);
 }
 
+void TestUtilOnFlatAST() {
+    Parser parser("(b + a) * sqrt(a + b) - 4");
+    AST ast = parser.buildAST();
+    FlatAST flat(ast);
+    auto nodes = ast.LRCTraversal();
+    for (FlatAST::Index i = 0; i < flat.size(); ++i) {
+        assert(util::CanonicalForm(flat, i) == util::CanonicalForm(nodes[i]));
+        assert(util::Height(flat, i) == util::Height(nodes[i]));
+        assert(util::NodeCount(flat, i) == util::NodeCount(nodes[i]));
+    }
+    assert(util::Height(FlatAST(), FlatAST::kNone) == 0);
+}
+
 void TestSubexpressionFinderDetectsRepeats() {
     Parser parser("(a + b) * (a + b) + (a + b)");
     AST ast = parser.buildAST();
@@ -293,6 +1012,463 @@ void TestSubexpressionFinderRespectsCommutativity() {
     assert(found);
 }
 
+void TestSubexpressionFinderGroupsByStructuralHash() {
+    Parser parser("(a * (b + c)) - ((c + b) * a) ^ (a * (c - b))");
+    AST ast = parser.buildAST();
+    auto repeated = SubexpressionFinder().find(ast);
+    assert(repeated.size() == 4);
+    assert(repeated.front().canonical == "*(+(b,c),a)");
+    assert(repeated.front().count == 2);
+    assert(repeated.front().occurrences[0]->hash == repeated.front().occurrences[1]->hash);
+
+    StructuralHash a = StructuralHash::combine(TokenType::ID, "a", {}, {});
+    StructuralHash b = StructuralHash::combine(TokenType::ID, "b", {}, {});
+    assert(StructuralHash::combine(TokenType::BinaryOperator, "-", a, b) !=
+           StructuralHash::combine(TokenType::BinaryOperator, "-", b, a));
+    assert(StructuralHash::combine(TokenType::BinaryOperator, "*", a, b) ==
+           StructuralHash::combine(TokenType::BinaryOperator, "*", b, a));
+
+    std::string chain = "x";
+    for (int i = 0; i < 50000; ++i) {
+        chain += " + x";
+    }
+    Parser long_chain(chain);
+    AST long_ast = long_chain.buildAST(AST::Allocation::Arena);
+    auto chain_repeats = SubexpressionFinder().find(long_ast);
+    assert(chain_repeats.size() == 1);
+    assert(chain_repeats.front().canonical == "x");
+    assert(chain_repeats.front().count == 50001);
+}
+
+void TestSubexpressionFinderKeepsOnlyMaximalRepeats() {
+    Parser parser("(a * b + c) - (a * b + c) / (a * b)");
+    auto repeated = SubexpressionFinder().find(parser.buildAST());
+    assert(repeated.size() == 2);
+    assert(repeated[0].canonical == "+(*(a,b),c)" && repeated[0].count == 2);
+    assert(repeated[1].canonical == "*(a,b)" && repeated[1].count == 3);
+
+    std::string chain = "a * b";
+    for (size_t i = 0; i < 5000; ++i) {
+        chain += i % 2 == 0 ? " + c * d" : " - a * b";
+    }
+    Parser deep("(" + chain + ") / (" + chain + ")");
+    AST ast = deep.buildAST();
+    auto maximal = SubexpressionFinder().find(ast);
+    assert(maximal.size() == 1);
+    assert(maximal.front().count == 2 && maximal.front().height == ast.height() - 1);
+    assert(SubexpressionFinder().find(FlatAST(ast)).size() == 1);
+}
+
+std::string MakeRepeatingInput(int depth, size_t& counter) {
+    static const char* const kTerms[] = {"(a + b) * c", "c * (b + a)", "sqrt(a) - 2", "x ^ 2", "lambda y. y + x"};
+    if (depth <= 0) {
+        return kTerms[(counter++ * 3) % 5];
+    }
+    std::string left = MakeRepeatingInput(depth - 1, counter);
+    std::string right = MakeRepeatingInput(depth - 1 - static_cast<int>(counter % 2), counter);
+    return "(" + left + (depth % 3 == 0 ? " * " : depth % 3 == 1 ? " + " : " - ") + right + ")";
+}
+
+void TestParallelSubexpressionFinderMatchesSerial() {
+    size_t counter = 0;
+    std::string input = MakeRepeatingInput(12, counter);
+    for (int i = 0; i < 300; ++i) {
+        input = "(" + input + ") - x";
+    }
+    Parser parser(input);
+    AST ast = parser.buildAST();
+    auto serial = SubexpressionFinder().find(ast);
+    assert(serial.size() >= 5);
+
+    for (size_t task_nodes : {size_t{0}, size_t{1}, size_t{64}, size_t{4096}}) {
+        SubexpressionFinder parallel(SubexpressionFinder::Options{SubexpressionFinder::Equivalence::Structural, 4,
+                                                                  task_nodes});
+        assert(parallel.threadCount() == 4);
+        auto repeated = parallel.find(ast);
+        assert(repeated.size() == serial.size());
+        for (size_t i = 0; i < serial.size(); ++i) {
+            assert(repeated[i].canonical == serial[i].canonical);
+            assert(repeated[i].count == serial[i].count);
+            assert(repeated[i].height == serial[i].height);
+            assert(repeated[i].node_count == serial[i].node_count);
+            assert(repeated[i].occurrences == serial[i].occurrences);
+        }
+    }
+    assert(SubexpressionFinder().threadCount() == 1);
+    assert(SubexpressionFinder(SubexpressionFinder::Options{}).find(AST()).empty());
+}
+
+void TestSubexpressionFinderAnswersTopKQueries() {
+    size_t counter = 0;
+    Parser parser(MakeRepeatingInput(10, counter));
+    AST ast = parser.buildAST();
+    SubexpressionFinder finder;
+    auto all = finder.find(ast);
+    assert(all.size() > 5);
+
+    SubexpressionFinder::Query defaults;
+    auto unfiltered = finder.find(ast, defaults);
+    assert(unfiltered.size() == all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        assert(unfiltered[i].canonical == all[i].canonical && unfiltered[i].occurrences == all[i].occurrences);
+    }
+
+    SubexpressionFinder::Query query;
+    query.exclude_leaves = true;
+    query.min_count = 3;
+    query.top_k = 4;
+    query.max_occurrences = 2;
+    query.ranking = SubexpressionFinder::Ranking::Savings;
+    std::vector<std::tuple<size_t, size_t, size_t, size_t>> expected;
+    for (const auto& item : all) {
+        if (item.height > 1 && item.count >= 3) {
+            expected.emplace_back((item.count - 1) * item.node_count, item.height, item.count, item.node_count);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), std::greater<>());
+    expected.resize(std::min<size_t>(expected.size(), 4));
+    assert(!expected.empty());
+
+    auto check = [&](const std::vector<RepeatedSubexpression>& top) {
+        assert(top.size() == expected.size());
+        for (size_t i = 0; i < top.size(); ++i) {
+            assert(std::make_tuple((top[i].count - 1) * top[i].node_count, top[i].height, top[i].count,
+                                   top[i].node_count) == expected[i]);
+            assert(top[i].occurrences.size() == std::min<size_t>(top[i].count, 2));
+        }
+    };
+    check(finder.find(ast, query));
+    check(finder.find(ast, CanonicalText(ast.getRoot()), query));
+    check(SubexpressionFinder(SubexpressionFinder::Options{SubexpressionFinder::Equivalence::Structural, 2, 16})
+              .find(ast, query));
+
+    FlatAST flat(ast);
+    auto flat_top = finder.find(flat, query);
+    assert(flat_top.size() == expected.size() && flat_top.front().occurrences.size() == 2);
+
+    SubexpressionFinder::Query prefix;
+    for (size_t k = 1; k <= all.size(); ++k) {
+        prefix.top_k = k;
+        auto truncated = finder.find(ast, prefix);
+        assert(truncated.size() == k);
+        for (size_t i = 0; i < k; ++i) {
+            assert(truncated[i].canonical == all[i].canonical);
+        }
+    }
+    Parser tied("(b * c) + (a * d) + (b * c) + (a * d)");
+    AST tied_ast = tied.buildAST();
+    prefix.top_k = 1;
+    for (const AST& candidate : {tied_ast, FlatAST(tied_ast).toAST()}) {
+        auto first = finder.find(candidate, prefix);
+        assert(first.size() == 1 && first.front().canonical == "*(a,d)");
+        assert(first.front().canonical == finder.find(candidate).front().canonical);
+    }
+    assert(finder.find(FlatAST(tied_ast), prefix).front().canonical == "*(a,d)");
+
+    Parser shared("(a + b) * (b + a) + (a + b) * c - c");
+    AST dag = shared.buildAST(AST::Allocation::Heap, AST::Sharing::HashConsed);
+    query.min_count = 2;
+    auto dag_top = finder.find(dag, query);
+    assert(dag_top.size() == 1 && dag_top.front().canonical == "+(a,b)" && dag_top.front().count == 3);
+}
+
+void TestHashConsedASTSharesRepeatedSubtrees() {
+    Parser parser("(a + b) * (b + a) + (a + b)");
+    AST ast = parser.buildAST(AST::Allocation::Heap, AST::Sharing::HashConsed);
+    const HashConsTable* table = ast.hashConsTable();
+    assert(table);
+    assert(table->uniqueNodes() < table->totalNodes());
+
+    AST::NodePtr product = ast.getRoot()->left;
+    assert(product->left == product->right);
+    assert(product->left == ast.getRoot()->right);
+    assert(table->occurrences(*product->left) == 3);
+    assert(table->occurrences(*ast.getRoot()->left->left->left) == 3);
+}
+
+void TestSubexpressionFinderMatchesOnHashConsedAST() {
+    const std::vector<std::string> inputs = {
+        "(a + b) * (a + b) + (a + b)",
+        "(a + b) + (b + a) + (a + b)",
+        "sqrt(x * 2) - sqrt(2 * x) ^ (x * 2)",
+        "lambda x. (x + 5) + (lambda y. y + 5) + (x + 5)",
+    };
+    SubexpressionFinder finder;
+    for (const std::string& input : inputs) {
+        Parser tree_parser(input);
+        auto expected = finder.find(tree_parser.buildAST());
+        Parser dag_parser(input);
+        auto actual = finder.find(dag_parser.buildAST(AST::Allocation::Heap, AST::Sharing::HashConsed));
+        assert(actual.size() == expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            assert(actual[i].canonical == expected[i].canonical);
+            assert(actual[i].count == expected[i].count);
+            assert(actual[i].height == expected[i].height);
+            assert(actual[i].occurrences.size() == 1);
+        }
+    }
+}
+
+void TestAnalysisAgreesOnFlatAST() {
+    const std::vector<std::string> inputs = {
+        "(a + b) * (a + b) + (a + b)",
+        "sqrt(x * 2) - sqrt(2 * x) ^ (x * 2)",
+        "lambda x. (x + 5) + (lambda y. y + 5) + (x + 5)",
+        "lambda x. lambda y. (x + y) * (lambda z. z * w) + 3",
+    };
+    SubexpressionFinder finder;
+    MSPChecker checker;
+    for (const std::string& input : inputs) {
+        Parser parser(input);
+        AST ast = parser.buildAST();
+        FlatAST flat(ast);
+        auto nodes = ast.LRCTraversal();
+
+        auto expected = finder.find(ast);
+        auto actual = finder.find(flat);
+        assert(actual.size() == expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            assert(actual[i].canonical == expected[i].canonical);
+            assert(actual[i].count == expected[i].count);
+            assert(actual[i].height == expected[i].height);
+            assert(actual[i].node_count == expected[i].node_count);
+            for (FlatAST::Index occurrence : actual[i].occurrences) {
+                assert(util::CanonicalForm(nodes[occurrence]) == actual[i].canonical);
+            }
+        }
+
+        auto expected_closed = checker.FindMaximallyClosed(ast);
+        auto actual_closed = checker.FindMaximallyClosed(flat);
+        assert(actual_closed.size() == expected_closed.size());
+        for (size_t i = 0; i < actual_closed.size(); ++i) {
+            assert(nodes[actual_closed[i]] == expected_closed[i]);
+        }
+    }
+}
+
+void TestACNormalFormFlattensChains() {
+    Parser parser("((a + b) + c) * 2 - (c + (b + a)) * (2 * x)");
+    AST ast = parser.buildAST();
+    ACNormalForm form(ast);
+    assert(form.size() == 14);
+    assert(form.canonical(form.root()) == "-(*(+(a,b,c),2),*(+(a,b,c),2,x))");
+
+    ACNormalForm::Index product = form.operand(form.root(), 1);
+    assert(form.arity(product) == 3);
+    assert(form.source(product) == ast.getRoot()->right);
+    assert(form.nodeCount(product) == 9);
+    assert(form.height(product) == 3);
+    auto sum_of = [&form](ACNormalForm::Index node) {
+        for (size_t i = 0; i < form.arity(node); ++i) {
+            if (form.token(form.operand(node, i)).value == "+") {
+                return form.operand(node, i);
+            }
+        }
+        return ACNormalForm::kNone;
+    };
+    ACNormalForm::Index left_sum = sum_of(form.operand(form.root(), 0));
+    ACNormalForm::Index right_sum = sum_of(product);
+    assert(left_sum != ACNormalForm::kNone && right_sum != ACNormalForm::kNone);
+    assert(form.classId(left_sum) == form.classId(right_sum));
+    assert(form.hash(left_sum) == form.hash(right_sum));
+    assert(form.parent(right_sum) == product);
+    assert(form.parent(form.root()) == ACNormalForm::kNone);
+    for (size_t i = 0; i + 1 < form.arity(product); ++i) {
+        assert(!(form.hash(form.operand(product, i + 1)) < form.hash(form.operand(product, i))));
+    }
+
+    Parser right_deep("a - (b - c)");
+    Parser left_deep("(a - b) - c");
+    ACNormalForm right_form(right_deep.buildAST());
+    ACNormalForm left_form(left_deep.buildAST());
+    assert(right_form.canonical(right_form.root()) == "-(a,-(b,c))");
+    assert(left_form.canonical(left_form.root()) == "-(-(a,b),c)");
+    assert(ACNormalForm(AST()).empty());
+}
+
+void TestSubexpressionFinderReportsOperandSets() {
+    Parser parser("sin(x + y + 1) * cos(x + (1 + y)) + (2 + x + y + z) * (z + (w + y) + x + 2)");
+    AST ast = parser.buildAST();
+    ACNormalForm form(ast);
+    SubexpressionFinder finder;
+    auto repeated = finder.find(form);
+    assert(finder.find(ACNormalForm()).empty());
+
+    auto find = [&repeated](const std::string& canonical) {
+        return std::find_if(repeated.begin(), repeated.end(),
+                            [&canonical](const ACRepeatedSubexpression& item) { return item.canonical == canonical; });
+    };
+    auto whole = find("+(1,x,y)");
+    assert(whole != repeated.end() && !whole->partial && whole->count == 2);
+    for (ACNormalForm::Index occurrence : whole->occurrences) {
+        assert(form.canonical(occurrence) == "+(1,x,y)");
+    }
+
+    auto pair = find("+(x,y)");
+    assert(pair != repeated.end() && pair->partial);
+    assert(pair->count == 4);
+    assert(pair->height == 2 && pair->node_count == 3);
+    auto wider = find("+(2,x,y,z)");
+    assert(wider != repeated.end() && wider->partial && wider->count == 2);
+    assert(wider->node_count == 7);
+    for (ACNormalForm::Index occurrence : wider->occurrences) {
+        assert(form.token(occurrence).value == "+" && form.arity(occurrence) >= 4);
+    }
+
+    Parser tree_parser("sin(x + y + 1) * cos(x + (1 + y))");
+    for (const auto& item : finder.find(tree_parser.buildAST())) {
+        assert(item.height == 1);
+    }
+
+    Parser nested("(x + y + z) * (x + y + z) * (x + y + z + w)");
+    auto nested_sets = finder.find(ACNormalForm(nested.buildAST()));
+    assert(std::count_if(nested_sets.begin(), nested_sets.end(),
+                         [](const ACRepeatedSubexpression& item) { return item.canonical == "+(x,y,z)"; }) == 1);
+
+    std::string product = "(x + y + 1)";
+    for (int i = 2; i <= 100; ++i) {
+        product += " * (x + y + " + std::to_string(i) + ")";
+    }
+    Parser many(product);
+    ACNormalForm shared_pairs(many.buildAST());
+    auto pairs = finder.find(shared_pairs);
+    auto shared = std::find_if(pairs.begin(), pairs.end(),
+                               [](const ACRepeatedSubexpression& item) { return item.canonical == "+(x,y)"; });
+    assert(shared != pairs.end() && shared->partial && shared->count == 100);
+}
+
+size_t CountRepeatsAbove(const std::vector<RepeatedSubexpression>& repeated, size_t height) {
+    return std::count_if(repeated.begin(), repeated.end(),
+                         [height](const RepeatedSubexpression& item) { return item.height > height; });
+}
+
+void TestDeBruijnHashesRenameBoundIdentifiers() {
+    Parser parser("(lambda x. lambda y. x - y + z) * (lambda a. lambda b. a - b + z)");
+    AST ast = parser.buildAST();
+    DeBruijnHashes hashes(ast);
+    assert(hashes.size() == ast.getRoot()->node_count);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        keys.push_back(std::string(hashes.token(i).value));
+    }
+    std::vector<std::string> expected = {"#", "#", "#1", "#0", "-", "z", "+", "lambda", "lambda",
+                                         "#", "#", "#1", "#0", "-", "z", "+", "lambda", "lambda", "*"};
+    assert(keys == expected);
+    assert(hashes.token(5).symbol == SymbolTable::global().intern("z"));
+    assert(hashes.token(2).symbol == kNoSymbol);
+    assert(hashes.hash(8) == hashes.hash(17));
+    assert(hashes.node(8) == ast.getRoot()->left);
+    assert(ast.getRoot()->left->hash != ast.getRoot()->right->hash);
+    assert(DeBruijnHashes(AST()).size() == 0);
+}
+
+void TestSubexpressionFinderGroupsAlphaEquivalentLambdas() {
+    SubexpressionFinder structural;
+    SubexpressionFinder alpha(SubexpressionFinder::Equivalence::Alpha);
+    assert(structural.equivalence() == SubexpressionFinder::Equivalence::Structural);
+
+    Parser renamed("(lambda x. x + 1) * (lambda y. y + 1)");
+    AST ast = renamed.buildAST();
+    assert(CountRepeatsAbove(structural.find(ast), 1) == 0);
+    auto repeated = alpha.find(ast);
+    assert(repeated.front().canonical == "lambda(x.+(1,x))");
+    assert(repeated.front().count == 2);
+    assert(repeated.front().occurrences.back() == ast.getRoot()->right);
+    assert(alpha.find(ast, CanonicalText(ast.getRoot())).front().canonical == "lambda(x.+(1,x))");
+
+    for (std::string input : {"(lambda x. lambda y. x - y) + (lambda a. lambda b. a - b)",
+                              "(lambda x. lambda x. x) - (lambda a. lambda b. b)",
+                              "(lambda x. y ^ x) * (lambda z. y ^ z)"}) {
+        Parser parser(input);
+        auto groups = alpha.find(parser.buildAST());
+        assert(groups.front().count == 2 && groups.front().canonical.rfind("lambda(", 0) == 0);
+    }
+    for (std::string input : {"(lambda x. lambda y. x - y) + (lambda a. lambda b. b - a)",
+                              "(lambda x. lambda x. x) - (lambda a. lambda b. a)",
+                              "(lambda x. y ^ x) * (lambda z. w ^ z)",
+                              "x + 1 - (lambda x. x + 1)"}) {
+        Parser parser(input);
+        assert(CountRepeatsAbove(alpha.find(parser.buildAST()), 1) == 0);
+    }
+
+    Parser shared("(lambda x. x * 2) - (lambda y. y * 2)");
+    AST dag = shared.buildAST(AST::Allocation::Heap, AST::Sharing::HashConsed);
+    assert(alpha.find(dag).front().count == 2);
+}
+
+void TestCorpusSubexpressionIndexCountsAcrossExpressions() {
+    CorpusSubexpressionIndex index;
+    for (size_t i = 0; i < 50; ++i) {
+        Parser parser("sin(x * y) + " + std::to_string(i) + " * (y * x - 1)");
+        index.add(parser.buildAST());
+    }
+    Parser unique("(a + b) * (a + b)");
+    AST probe = unique.buildAST();
+    index.add(probe);
+
+    assert(index.expressionCount() == 51);
+    assert(index.subtreeCount() == 50 * 6 + 3);
+    auto top = index.top(3);
+    assert(top.size() == 3);
+    assert(top[0].canonical == "*(x,y)" && top[0].count == 100);
+    assert(top[1].canonical == "-(*(x,y),1)" && top[1].count == 50);
+    assert(top[2].canonical == "sin(*(x,y))" && top[2].count == 50);
+    assert(top[0].occurrences.empty());
+    assert(index.estimate(*probe.getRoot()->left) == 2);
+    assert(index.top(1000).size() == 4);
+    assert(index.errorBound() == 1 && index.confidence() > 0.98);
+}
+
+void TestCorpusSubexpressionIndexBoundsErrorInFixedMemory() {
+    CorpusSubexpressionIndex::Options options;
+    options.width = 100;
+    options.depth = 3;
+    options.capacity = 8;
+    CorpusSubexpressionIndex index(options);
+    size_t budget = index.memoryBytes();
+
+    std::mt19937 rng(7);
+    std::vector<size_t> counts(400, 0);
+    for (size_t i = 0; i < 20000; ++i) {
+        size_t term = i % 4 == 0 ? 0 : rng() % counts.size();
+        ++counts[term];
+        Parser parser("x ^ " + std::to_string(term));
+        index.add(parser.buildAST());
+    }
+
+    auto top = index.top(1);
+    assert(top.size() == 1 && top[0].canonical == "^(x,0)");
+    assert(top[0].count >= counts[0] && top[0].count <= counts[0] + index.errorBound());
+    assert(index.memoryBytes() < budget + 8 * 64);
+    assert(index.top(100).size() <= 8);
+
+    options.max_label_length = 16;
+    CorpusSubexpressionIndex labelled(options);
+    size_t labelled_budget = labelled.memoryBytes();
+    std::string sum = "0";
+    for (size_t i = 1; i < 200; ++i) {
+        sum += " + " + std::to_string(i);
+        Parser parser(sum);
+        AST ast = parser.buildAST();
+        labelled.add(ast);
+        labelled.add(ast);
+    }
+    for (const RepeatedSubexpression& repeat : labelled.top(8)) {
+        assert(repeat.canonical.size() <= 16 + 3);
+        assert(repeat.node_count < 16 || repeat.canonical.substr(16) == "...");
+    }
+    assert(labelled.memoryBytes() < labelled_budget + 8 * (64 + options.max_label_length + 3));
+
+    options.capacity = 0;
+    bool threw = false;
+    try {
+        CorpusSubexpressionIndex invalid(options);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+}
+
 void TestMSPCheckerOnLambdaAndConstants() {
     Parser parser("lambda x. (x + 5) + (lambda y. y) + 7");
     AST ast = parser.buildAST();
@@ -327,6 +1503,19 @@ void TestMSPCheckerSkipsNonClosed() {
     }
 }
 
+void TestMSPCheckerOnHashConsedParameters() {
+    MSPChecker checker;
+    for (const char* source : {"(lambda x. y) + x", "x + (lambda x. y)"}) {
+        for (AST::Sharing sharing : {AST::Sharing::Tree, AST::Sharing::HashConsed}) {
+            Parser parser(source);
+            auto closed = checker.FindMaximallyClosed(parser.buildAST(AST::Allocation::Heap, sharing));
+            assert(closed.size() == 1);
+            assert(closed.front()->token.type == TokenType::ID);
+            assert(closed.front()->token.value == "x");
+        }
+    }
+}
+
 void TestParserAndTokenizerErrorPropagation() {
     ExpectThrows<ParserException>([] {
         Parser parser("1 + (2 * 3");
@@ -346,6 +1535,13 @@ int main() {
     TestTokenizerWhitespaceAndReset();
     TestTokenizerUnaryFunctionsAndLambda();
     TestTokenizerRejectsUnknownIdentifiers();
+    TestTokenizerViewsReferenceInput();
+    TestTokenizerNumberLiterals();
+    TestTokenizerKeywordLookup();
+    TestStreamTokenizerSplitsAcrossChunks();
+    TestSymbolTableInternsIdentifiers();
+    TestPDAAcceptsTokenViews();
+    TestPDABuildsSameASTAsParser();
 
     TestParserStructureAndPrecedence();
     TestParserExponentRightAssociative();
@@ -356,22 +1552,56 @@ int main() {
     TestParserRejectsUnaryFunctionWithoutParentheses();
     TestParserRejectsMismatchedParentheses();
     TestParserAndTokenizerErrorPropagation();
+    TestParserReadsFromStream();
+    TestParserReadsFromMappedFile();
+    TestBinaryASTRoundTripsThroughMappedFile();
+    TestBinaryASTRejectsCorruptInput();
 
     TestASTLeafAndNodeConstruction();
     TestASTTraversals();
     TestASTSetRootResetsParent();
+    TestASTLazyTraversalRanges();
+    TestASTTraversalsOnDeepTrees();
+    TestPersistentASTSharesUntouchedSubtrees();
+    TestParserArenaAllocation();
+    TestParserOperatorAssociativity();
+    TestParserUnboundedNesting();
+    TestParserTryBuildReportsStructuredErrors();
+    TestParserRecordsSourceSpans();
+    TestIncrementalReparseReusesUntouchedSubtrees();
+    TestWorkStealingPoolRunsEveryTask();
+    TestBatchParserPreservesInputOrder();
+    TestFlatASTRoundTripsInPostOrder();
 
+    TestASTCachesSynthesizedAttributes();
+    TestCanonicalTextRecordsSubtreeSpans();
+    TestCanonicalTextOnDeepTrees();
     TestUtilCanonicalForm();
     TestUtilHeightAndNodeCount();
     TestUtilIsClosedSubtree();
     TestUtilCollectNodesPreOrder();
+    TestUtilOnFlatAST();
 
     TestSubexpressionFinderDetectsRepeats();
     TestSubexpressionFinderRespectsCommutativity();
+    TestSubexpressionFinderGroupsByStructuralHash();
+    TestSubexpressionFinderKeepsOnlyMaximalRepeats();
+    TestParallelSubexpressionFinderMatchesSerial();
+    TestSubexpressionFinderAnswersTopKQueries();
+    TestHashConsedASTSharesRepeatedSubtrees();
+    TestSubexpressionFinderMatchesOnHashConsedAST();
 
     TestMSPCheckerOnLambdaAndConstants();
     TestMSPCheckerSkipsNonClosed();
     TestMSPCheckerOnStandaloneConstant();
+    TestMSPCheckerOnHashConsedParameters();
+    TestAnalysisAgreesOnFlatAST();
+    TestACNormalFormFlattensChains();
+    TestSubexpressionFinderReportsOperandSets();
+    TestDeBruijnHashesRenameBoundIdentifiers();
+    TestSubexpressionFinderGroupsAlphaEquivalentLambdas();
+    TestCorpusSubexpressionIndexCountsAcrossExpressions();
+    TestCorpusSubexpressionIndexBoundsErrorInFixedMemory();
 
     std::cout << "All tests passed successfully.\n";
     return 0;
@@ -1,99 +1,195 @@
 #include "subtree_utils.h"
+#include "../ast/canonical_text.h"
 #include <algorithm>
-#include <sstream>
+#include <cstdint>
+#include <string_view>
 #include <utility>
 
 namespace util {
 
 namespace {
-std::string CanonicalBinary(const std::string& op,
-                            const std::string& left,
-                            const std::string& right) {
-    std::ostringstream oss;
-    oss << op << "(" << left << "," << right << ")";
-    return oss.str();
-}
-}
+struct FlatPiece {
+    FlatAST::Index node = FlatAST::kNone;
+    std::string_view text;
+};
 
-std::string CanonicalForm(const AST::NodePtr& node) {
-    if (!node) {
-        return "";
+class FlatCanonicalText {
+  public:
+    FlatCanonicalText(const FlatAST& ast, FlatAST::Index node)
+        : ast_(ast), begin_(ast.subtreeBegin(node)), hashes_(node - begin_ + 1), swaps_(node - begin_ + 1, false) {
+        for (FlatAST::Index i = begin_; i <= node; ++i) {
+            FlatAST::Index left = ast_.left(i);
+            FlatAST::Index right = ast_.right(i);
+            TokenView token = ast_.token(i);
+            hashes_[i - begin_] = StructuralHash::combine(
+                token.type, token.value, left != FlatAST::kNone ? hashes_[left - begin_] : StructuralHash{},
+                right != FlatAST::kNone ? hashes_[right - begin_] : StructuralHash{});
+            FlatAST::Opcode opcode = ast_.opcode(i);
+            if ((opcode == FlatAST::Opcode::Add || opcode == FlatAST::Opcode::Multiply) && left != FlatAST::kNone) {
+                swaps_[i - begin_] = right == FlatAST::kNone || compare(left, right) > 0;
+            }
+        }
     }
 
-    const Token& token = node->token;
-    switch (token.type) {
-        case TokenType::Number:
-        case TokenType::ID:
-            return token.value;
-        case TokenType::UnaryOperator: {
-            std::string child = CanonicalForm(node->left);
-            return token.value + "(" + child + ")";
+    void append(FlatAST::Index node, std::string& out) const {
+        std::vector<FlatPiece> stack;
+        expand(node, stack);
+        for (std::string_view chunk = next(stack); !chunk.empty(); chunk = next(stack)) {
+            out.append(chunk);
         }
-        case TokenType::BinaryOperator: {
-            std::string left = CanonicalForm(node->left);
-            std::string right = CanonicalForm(node->right);
-            if (token.value == "+" || token.value == "*") {
-                if (left > right) {
+    }
+
+  private:
+    const FlatAST& ast_;
+    FlatAST::Index begin_;
+    std::vector<StructuralHash> hashes_;
+    std::vector<bool> swaps_;
+
+    void push(FlatAST::Index node, std::vector<FlatPiece>& stack) const {
+        if (node != FlatAST::kNone) {
+            stack.push_back({node, {}});
+        }
+    }
+
+    void expand(FlatAST::Index node, std::vector<FlatPiece>& stack) const {
+        TokenView token = ast_.token(node);
+        FlatAST::Index left = ast_.left(node);
+        FlatAST::Index right = ast_.right(node);
+        switch (token.type) {
+            case TokenType::UnaryOperator:
+                stack.push_back({FlatAST::kNone, ")"});
+                push(left, stack);
+                stack.push_back({FlatAST::kNone, "("});
+                stack.push_back({FlatAST::kNone, token.value});
+                break;
+            case TokenType::BinaryOperator:
+                if (swaps_[node - begin_]) {
                     std::swap(left, right);
                 }
+                stack.push_back({FlatAST::kNone, ")"});
+                push(right, stack);
+                stack.push_back({FlatAST::kNone, ","});
+                push(left, stack);
+                stack.push_back({FlatAST::kNone, "("});
+                stack.push_back({FlatAST::kNone, token.value});
+                break;
+            case TokenType::Lambda:
+                stack.push_back({FlatAST::kNone, ")"});
+                push(right, stack);
+                stack.push_back({FlatAST::kNone, "."});
+                push(left, stack);
+                stack.push_back({FlatAST::kNone, "lambda("});
+                break;
+            default:
+                stack.push_back({FlatAST::kNone, token.value});
+                break;
+        }
+    }
+
+    std::string_view next(std::vector<FlatPiece>& stack) const {
+        while (!stack.empty()) {
+            FlatPiece piece = stack.back();
+            stack.pop_back();
+            if (piece.node != FlatAST::kNone) {
+                expand(piece.node, stack);
+            } else if (!piece.text.empty()) {
+                return piece.text;
             }
-            return CanonicalBinary(token.value, left, right);
         }
-        case TokenType::Lambda: {
-            std::string parameter = node->left ? CanonicalForm(node->left) : "";
-            std::string body = CanonicalForm(node->right);
-            return "lambda(" + parameter + "." + body + ")";
+        return {};
+    }
+
+    int compare(FlatAST::Index lhs, FlatAST::Index rhs) const {
+        if (lhs == rhs || hashes_[lhs - begin_] == hashes_[rhs - begin_]) {
+            return 0;
+        }
+        std::vector<FlatPiece> lhs_stack;
+        std::vector<FlatPiece> rhs_stack;
+        expand(lhs, lhs_stack);
+        expand(rhs, rhs_stack);
+        std::string_view lhs_chunk;
+        std::string_view rhs_chunk;
+        while (true) {
+            if (lhs_chunk.empty()) {
+                lhs_chunk = next(lhs_stack);
+            }
+            if (rhs_chunk.empty()) {
+                rhs_chunk = next(rhs_stack);
+            }
+            if (lhs_chunk.empty() || rhs_chunk.empty()) {
+                return lhs_chunk.empty() == rhs_chunk.empty() ? 0 : (lhs_chunk.empty() ? -1 : 1);
+            }
+            size_t common = std::min(lhs_chunk.size(), rhs_chunk.size());
+            if (int order = lhs_chunk.substr(0, common).compare(rhs_chunk.substr(0, common)); order != 0) {
+                return order < 0 ? -1 : 1;
+            }
+            lhs_chunk.remove_prefix(common);
+            rhs_chunk.remove_prefix(common);
         }
-        default:
-            return token.value;
     }
+};
+}
+
+std::string CanonicalForm(const AST::NodePtr& node) {
+    return node ? CanonicalText::print(*node) : "";
 }
 
 size_t Height(const AST::NodePtr& node) {
-    if (!node) {
-        return 0;
-    }
-    return 1 + std::max(Height(node->left), Height(node->right));
+    return node ? node->height : 0;
 }
 
 size_t NodeCount(const AST::NodePtr& node) {
-    if (!node) {
-        return 0;
-    }
-    return 1 + NodeCount(node->left) + NodeCount(node->right);
+    return node ? node->node_count : 0;
 }
 
 bool IsClosedSubtree(const AST::NodePtr& node) {
-    return IsClosedSubtree(node, {});
+    BoundSymbols bound;
+    return IsClosedSubtree(node, bound);
 }
 
 bool IsClosedSubtree(const AST::NodePtr& node,
                      std::unordered_set<std::string> bound_identifiers) {
+    BoundSymbols bound;
+    for (const std::string& name : bound_identifiers) {
+        bound.bind(SymbolTable::global().intern(name));
+    }
+    return IsClosedSubtree(node, bound);
+}
+
+bool IsClosedSubtree(const AST::NodePtr& node, BoundSymbols& bound) {
     if (!node) {
         return true;
     }
+    if ((node->free_symbols & AST::Node::kUntrackedSymbols) == 0) {
+        for (uint64_t free = node->free_symbols; free != 0; free &= free - 1) {
+            if (!bound.isBound(static_cast<SymbolId>(__builtin_ctzll(free)))) {
+                return false;
+            }
+        }
+        return true;
+    }
     const Token& token = node->token;
     switch (token.type) {
         case TokenType::Number:
             return true;
         case TokenType::ID:
-            return bound_identifiers.find(token.value) != bound_identifiers.end();
+            return bound.isBound(token.symbol);
         case TokenType::UnaryOperator:
-            return IsClosedSubtree(node->left, std::move(bound_identifiers));
+            return IsClosedSubtree(node->left, bound);
         case TokenType::BinaryOperator: {
-            auto left_bound = bound_identifiers;
-            bool left_closed = IsClosedSubtree(node->left, std::move(left_bound));
-            bool right_closed = IsClosedSubtree(node->right, std::move(bound_identifiers));
+            bool left_closed = IsClosedSubtree(node->left, bound);
+            bool right_closed = IsClosedSubtree(node->right, bound);
             return left_closed && right_closed;
         }
         case TokenType::Lambda: {
+            SymbolId parameter = kNoSymbol;
             if (node->left && node->left->token.type == TokenType::ID) {
-                bound_identifiers.insert(node->left->token.value);
+                parameter = node->left->token.symbol;
             }
-            if (node->left) {
-                IsClosedSubtree(node->left, bound_identifiers);
-            }
-            return IsClosedSubtree(node->right, std::move(bound_identifiers));
+            bound.bind(parameter);
+            bool closed = IsClosedSubtree(node->right, bound);
+            bound.unbind(parameter);
+            return closed;
         }
         default:
             return false;
@@ -110,4 +206,37 @@ void CollectNodesPreOrder(const AST::NodePtr& node,
     CollectNodesPreOrder(node->right, out);
 }
 
+std::string CanonicalForm(const FlatAST& ast, FlatAST::Index node) {
+    std::string out;
+    if (node != FlatAST::kNone) {
+        FlatCanonicalText(ast, node).append(node, out);
+    }
+    return out;
+}
+
+size_t Height(const FlatAST& ast, FlatAST::Index node) {
+    if (node == FlatAST::kNone) {
+        return 0;
+    }
+    FlatAST::Index begin = ast.subtreeBegin(node);
+    std::vector<uint32_t> heights(node - begin + 1);
+    for (FlatAST::Index i = begin; i <= node; ++i) {
+        uint32_t height = 0;
+        for (FlatAST::Index child : {ast.left(i), ast.right(i)}) {
+            if (child != FlatAST::kNone) {
+                height = std::max(height, heights[child - begin]);
+            }
+        }
+        heights[i - begin] = height + 1;
+    }
+    return heights.back();
+}
+
+size_t NodeCount(const FlatAST& ast, FlatAST::Index node) {
+    if (node == FlatAST::kNone) {
+        return 0;
+    }
+    return node - ast.subtreeBegin(node) + 1;
+}
+
 }
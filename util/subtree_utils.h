@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../ast/ast.h"
+#include "../ast/flat_ast.h"
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -13,8 +14,13 @@ size_t NodeCount(const AST::NodePtr& node);
 bool IsClosedSubtree(const AST::NodePtr& node);
 bool IsClosedSubtree(const AST::NodePtr& node,
                      std::unordered_set<std::string> bound_identifiers);
+bool IsClosedSubtree(const AST::NodePtr& node, BoundSymbols& bound);
 void CollectNodesPreOrder(const AST::NodePtr& node,
                           std::vector<AST::NodePtr>& out);
 
+std::string CanonicalForm(const FlatAST& ast, FlatAST::Index node);
+size_t Height(const FlatAST& ast, FlatAST::Index node);
+size_t NodeCount(const FlatAST& ast, FlatAST::Index node);
+
 }
 
@@ -0,0 +1,139 @@
+#include "work_stealing_pool.h"
+#include <algorithm>
+
+namespace util {
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    queues_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(thread_count - 1);
+    for (size_t worker = 1; worker < thread_count; ++worker) {
+        threads_.emplace_back(&WorkStealingPool::workerLoop, this, worker);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t WorkStealingPool::threadCount() const {
+    return queues_.size();
+}
+
+void WorkStealingPool::run(size_t task_count, const TaskBody& body) {
+    if (task_count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t task = 0; task < task_count; ++task) {
+            queues_[task % queues_.size()]->tasks.push_back(task);
+        }
+        remaining_.store(task_count);
+        failure_ = nullptr;
+        body_ = &body;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    drain(0, body);
+
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return remaining_.load() == 0 && active_ == 0; });
+        body_ = nullptr;
+        failure = failure_;
+        failure_ = nullptr;
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void WorkStealingPool::workerLoop(size_t worker) {
+    size_t seen = 0;
+    while (true) {
+        const TaskBody* body = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+            if (body_ == nullptr) {
+                continue;
+            }
+            body = body_;
+            ++active_;
+        }
+        drain(worker, *body);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+        }
+        done_.notify_all();
+    }
+}
+
+void WorkStealingPool::drain(size_t worker, const TaskBody& body) {
+    size_t task = 0;
+    while (popLocal(worker, task) || steal(worker, task)) {
+        try {
+            body(task, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!failure_) {
+                failure_ = std::current_exception();
+            }
+        }
+        finishTask();
+    }
+}
+
+bool WorkStealingPool::popLocal(size_t worker, size_t& task) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, size_t& task) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        Queue& victim = *queues_[(thief + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::finishTask() {
+    if (remaining_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_.notify_all();
+    }
+}
+
+}
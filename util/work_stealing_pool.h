@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+class WorkStealingPool {
+  public:
+    using TaskBody = std::function<void(size_t task, size_t worker)>;
+
+    explicit WorkStealingPool(size_t thread_count = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t threadCount() const;
+    void run(size_t task_count, const TaskBody& body);
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const TaskBody* body_ = nullptr;
+    size_t generation_ = 0;
+    size_t active_ = 0;
+    bool stopping_ = false;
+    std::atomic<size_t> remaining_{0};
+    std::exception_ptr failure_;
+
+    void workerLoop(size_t worker);
+    void drain(size_t worker, const TaskBody& body);
+    bool popLocal(size_t worker, size_t& task);
+    bool steal(size_t thief, size_t& task);
+    void finishTask();
+};
+
+}